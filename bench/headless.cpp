@@ -0,0 +1,605 @@
+// Headless benchmark, renders the map offscreen along a scripted camera path
+// and reports frame and per-stage timings. No window or GPU is needed.
+//
+// usage: DOOM_headless --bench [--map file] [--frames N] [--path file] [--threads N]
+//                      [--format csv|json] [--out file] [--trace file] [--texture file] [--flat]
+//                      [--budget-ms N] [--realtime] [--fps N] [--demo file] [--record file]
+//                      [--hashes file] [--save-frames file] [--diff-frames file]
+//                      [--sprites N] [--sprite file] [--actors N] [--sim-only]
+//                      [--asset-budget-mb N] [--capture file] [--pipeline name]
+//
+// --flat draws the walls with flat shading instead of the texture. --budget-ms lets
+// the dynamic resolution controller react to the measured frame times, the report
+// then says how often it changed the resolution and how many frames fit the budget.
+//
+// --pipeline draws the walls with one of the specialized wall pipelines, like
+// wireframe or flat_unlit_2, the default is textured. DOOM_bench has the raster
+// stage of every one of them side by side.
+//
+// --realtime runs the game loop instead of the camera path: the fixed timestep
+// simulation moves the camera from scripted input in real time and frames draw the
+// interpolated camera, optionally paced to --fps. The report then adds the time
+// between frames and the input latency, from the moment an input changes to the
+// end of the first frame that shows a tick which sampled it. --record saves the
+// scripted input as a demo.
+//
+// --demo plays a demo as a timedemo instead of the camera path, one simulation tick
+// per frame as fast as possible, for at most --frames frames. --hashes writes a
+// hash of every finished frame, one per line, and the report adds a hash of the
+// whole run, so a change that alters the picture shows up next to the timings.
+//
+// --save-frames writes every frame as raw palette indices and --diff-frames reads
+// such a file back and counts the pixels that differ, for example between the
+// float and the DOOM_FIXED_POINT build. Both runs need the same frames and sizes.
+//
+// The report also counts the sectors and walls the renderer visited per frame
+// against the totals of the level. A sector seen through several portals counts
+// once for each, a level without sectors only counts walls.
+//
+// --sprites scatters N billboard sprites over the open space of the level, always
+// the same ones for the same level, drawn with the image from --sprite or the
+// built-in ones. Their culling and binning shows up as the sprites stage and the
+// report adds how many were in view per frame.
+//
+// --actors spawns N actors that walk the level, one simulation tick of them per
+// frame, stepped across the --threads job pool. --sim-only only ticks the actors,
+// --frames times, and draws nothing. The report adds the actor ticks per second
+// and a hash of where the actors ended up, which is the same for every thread
+// count. Run it at a few --threads values to see how the simulation scales.
+//
+// --texture streams in on the asset loader like it does in the game, so the first
+// frames may draw the built-in texture. Runs that hash, save or diff frames wait
+// for it first. --asset-budget-mb sets the texture cache budget. The report adds
+// the time from start up to the end of the first frame, when the assets were all
+// loaded and the cache counters.
+//
+// --capture records every frame to a Y4M video at the window size. The copy into
+// the capture ring shows up as the capture stage, the report adds how many frames
+// were written and how many dropped because the writer thread fell behind.
+//
+// A path file holds one "x y angle" keyframe per line, '#' starts a comment.
+// Keyframes are spread evenly over the run and interpolated linearly.
+
+#include "actor.hpp"
+#include "assets.hpp"
+#include "capture.hpp"
+#include "bsp.hpp"
+#include "demo.hpp"
+#include "engine.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "resolution.hpp"
+#include "sim.hpp"
+#include "sprite.hpp"
+#include "transform.hpp"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#undef main
+
+#define MAX_PATH_KEYS 1024
+#define MAX_INPUT_EVENTS 65536
+
+typedef struct {
+    float x, y, angle;
+} CameraKey;
+
+// Loop through the open space of the default map
+static const CameraKey flyThrough[] = {
+    { 452.00f, 209.00f, 0.50f },
+    { 600.00f, 290.00f, 0.00f },
+    { 800.00f, 290.00f, 0.71f },
+    { 950.00f, 420.00f, 2.32f },
+    { 800.00f, 580.00f, 3.06f },
+    { 560.00f, 600.00f, 3.29f },
+    { 300.00f, 560.00f, 4.01f },
+    { 80.00f, 300.00f, 6.01f },
+    { 300.00f, 240.00f, 6.08f },
+    { 452.00f, 209.00f, 6.78f },
+};
+
+enum {
+    STAGE_ACTORS,
+    STAGE_COLLISION,
+    STAGE_TRANSFORM,
+    STAGE_PROJECT,
+    STAGE_SPRITES,
+    STAGE_RASTER,
+    STAGE_EXPAND,
+    STAGE_CAPTURE, // --capture only
+    STAGE_FRAME,
+    STAGE_INTERVAL, // --realtime only, from the end of one frame to the end of the next
+    STAGE_LATENCY,  // --realtime only, sampled per input event
+    STAGE_LOAD, // load stages are sampled once, before the first frame
+    STAGE_BSP_BUILD,
+    STAGE_GRID_BUILD,
+    STAGE_COUNT
+};
+
+static const char* stageNames[STAGE_COUNT] = { "actors", "collision", "transform", "project", "sprites", "raster", "expand", "capture", "frame", "frame_interval", "input_latency", "load", "bsp_build", "grid_build" };
+
+typedef struct {
+    double min, mean, p50, p99, max;
+    double stddev;
+} StageSummary;
+
+typedef struct {
+    int frames;          // compared
+    int framesDiffering;
+    double pixels;
+    double pixelsDiffering;
+    double worstFrame;   // share of differing pixels in the worst frame
+} ImageDiff;
+
+typedef struct {
+    double sectors, walls;     // visited, summed over the run
+    int maxSectors, maxWalls;
+    double spritesVisible;     // summed over the run
+} VisibilitySummary;
+
+// Scripted input for --realtime, always walking and flipping between turning left
+// and right at irregular times. Every flip is an input event.
+typedef struct {
+    double time;  // seconds since the run started
+    Uint64 tick;  // first tick that sampled it, shown once sim.ticks reaches it
+} InputEvent;
+
+static InputEvent inputEvents[MAX_INPUT_EVENTS];
+static int inputEventCount, inputEventsSampled, inputEventsShown;
+static double nextInputTime;
+static Uint64 runStart;
+static Uint32 inputRng = 12345;
+
+static CameraKey pathKeys[MAX_PATH_KEYS];
+static int pathKeyCount;
+
+int LoadCameraPath(const char* fileName) {
+    FILE* file = fopen(fileName, "r");
+    if (!file) return 0;
+
+    char line[256];
+    pathKeyCount = 0;
+    while (fgets(line, sizeof(line), file) && pathKeyCount < MAX_PATH_KEYS) {
+        CameraKey key;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%f %f %f", &key.x, &key.y, &key.angle) == 3) pathKeys[pathKeyCount++] = key;
+    }
+
+    fclose(file);
+    return pathKeyCount > 0;
+}
+
+void UseBuiltinPath() {
+    pathKeyCount = sizeof(flyThrough) / sizeof(flyThrough[0]);
+    memcpy(pathKeys, flyThrough, sizeof(flyThrough));
+}
+
+CameraKey SamplePath(int frame, int frameCount) {
+    if (pathKeyCount == 1 || frameCount <= 1) return pathKeys[0];
+
+    float pos = static_cast<float>(frame) * (pathKeyCount - 1) / (frameCount - 1);
+    int k = static_cast<int>(pos);
+    if (k >= pathKeyCount - 1) return pathKeys[pathKeyCount - 1];
+
+    float t = pos - k;
+    CameraKey a = pathKeys[k], b = pathKeys[k + 1], key;
+    key.x = a.x + (b.x - a.x) * t;
+    key.y = a.y + (b.y - a.y) * t;
+    key.angle = a.angle + (b.angle - a.angle) * t;
+    return key;
+}
+
+static int CompareDouble(const void* a, const void* b) {
+    double da = *static_cast<const double*>(a), db = *static_cast<const double*>(b);
+    return (da > db) - (da < db);
+}
+
+StageSummary Summarize(double* samples, int count) {
+    qsort(samples, count, sizeof(double), CompareDouble);
+
+    StageSummary sum;
+    sum.min = samples[0];
+    sum.max = samples[count - 1];
+    sum.p50 = samples[(count - 1) * 50 / 100];
+    sum.p99 = samples[(count - 1) * 99 / 100];
+    sum.mean = 0;
+    for (int i = 0; i < count; i++) sum.mean += samples[i];
+    sum.mean /= count;
+
+    sum.stddev = 0;
+    for (int i = 0; i < count; i++) sum.stddev += (samples[i] - sum.mean) * (samples[i] - sum.mean);
+    sum.stddev = sqrt(sum.stddev / count);
+
+    return sum;
+}
+
+static double RunSeconds() {
+    return static_cast<double>(SDL_GetPerformanceCounter() - runStart) / SDL_GetPerformanceFrequency();
+}
+
+PlayerInput ScriptedInput(void* userData) {
+    PlayerInput input;
+    double now = RunSeconds();
+    while (nextInputTime <= now) {
+        if (inputEventCount < MAX_INPUT_EVENTS) inputEvents[inputEventCount++].time = nextInputTime;
+        inputRng = inputRng * 1664525 + 1013904223;
+        nextInputTime += 0.05 + 0.15 * ((inputRng >> 8) / 16777216.0);
+    }
+
+    for (; inputEventsSampled < inputEventCount; inputEventsSampled++) inputEvents[inputEventsSampled].tick = sim.ticks + 1;
+
+    memset(&input, 0, sizeof(input));
+    input.forward = 1;
+    input.left = inputEventCount & 1;
+    input.right = !(inputEventCount & 1);
+    DemoRecordTick(input);
+    return input;
+}
+
+void WriteReport(FILE* out, int json, int frames, StageSummary* stages, int* sampleCounts, const char* runHash, const ImageDiff* diff, const VisibilitySummary* visited, double firstFrameMs) {
+    // --sim-only draws nothing, so no frame counted toward the budget
+    double inBudget = resolution.frames > 0 ? static_cast<double>(resolution.framesInBudget) / resolution.frames : 0;
+    if (json) {
+        fprintf(out, "{\n  \"frames\": %d,\n  \"mean_fps\": %.1f,\n  \"threads\": %d,\n  \"pipeline\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"walls\": %d,\n  \"segs\": %d,\n  \"bsp_nodes\": %d,\n",
+            frames, 1000.0 / stages[STAGE_FRAME].mean, JobsThreadCount(), renderPipelines[renderPipeline].name, screenW, screenH, level.wallCount, bsp.segCount, bsp.nodeCount);
+        fprintf(out, "  \"arena_high_water_bytes\": %zu,\n  \"arena_heap_allocs\": %d,\n  \"sim_ticks\": %llu,\n  \"stages\": {\n",
+            frameArena.highWater, frameArena.heapAllocs, static_cast<unsigned long long>(sim.ticks));
+        const char* separator = "";
+        for (int s = 0; s < STAGE_COUNT; s++) {
+            if (!sampleCounts[s]) continue;
+            fprintf(out, "%s    \"%s\": { \"min_ms\": %.4f, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"stddev_ms\": %.4f }",
+                separator, stageNames[s], stages[s].min, stages[s].mean, stages[s].p50, stages[s].p99, stages[s].max, stages[s].stddev);
+            separator = ",\n";
+        }
+        fprintf(out, "\n");
+        fprintf(out, "  },\n  \"resolution\": {\n    \"budget_ms\": %.2f,\n    \"changes\": %d,\n    \"in_budget\": %.4f,\n    \"frames_at\": {",
+            resolution.targetMs, resolution.changes, inBudget);
+        for (int l = 0; l < RES_LEVEL_COUNT; l++) {
+            int w, h;
+            ResolutionLevelSize(l, &w, &h);
+            fprintf(out, " \"%dx%d\": %d%s", w, h, resolution.framesAtLevel[l], l + 1 < RES_LEVEL_COUNT ? "," : "");
+        }
+        fprintf(out, " }\n  },\n  \"visibility\": { \"sectors\": %d, \"sectors_visited_mean\": %.1f, \"sectors_visited_max\": %d, \"walls\": %d, \"walls_visited_mean\": %.1f, \"walls_visited_max\": %d, \"sprites\": %d, \"sprites_visible_mean\": %.1f }",
+            level.sectorCount, visited->sectors / frames, visited->maxSectors, level.wallCount, visited->walls / frames, visited->maxWalls,
+            sprites.count, visited->spritesVisible / frames);
+        if (actors.count > 0) {
+            fprintf(out, ",\n  \"actors\": { \"count\": %d, \"actor_ticks_per_s\": %.0f, \"state_hash\": \"%016llx\" }",
+                actors.count, actors.count / (stages[STAGE_ACTORS].mean / 1000.0), static_cast<unsigned long long>(HashActors()));
+        }
+        fprintf(out, ",\n  \"assets\": { \"first_frame_ms\": %.2f, \"ready_ms\": %.2f, \"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"loads\": %llu, \"failures\": %llu, \"bytes_peak\": %zu, \"decode_ms\": %.2f }",
+            firstFrameMs, assetStats.readyMs, static_cast<unsigned long long>(assetStats.hits), static_cast<unsigned long long>(assetStats.misses),
+            static_cast<unsigned long long>(assetStats.evictions), static_cast<unsigned long long>(assetStats.loads),
+            static_cast<unsigned long long>(assetStats.failures), assetStats.bytesPeak, assetStats.decodeMs);
+        if (sampleCounts[STAGE_CAPTURE]) {
+            fprintf(out, ",\n  \"capture\": { \"frames\": %d, \"written\": %d, \"dropped\": %d, \"write_ms_mean\": %.4f }",
+                captureStats.frames, captureStats.written, captureStats.dropped, captureStats.written > 0 ? captureStats.writeMs / captureStats.written : 0);
+        }
+        if (runHash) fprintf(out, ",\n  \"run_hash\": \"%s\"", runHash);
+        if (diff) {
+            fprintf(out, ",\n  \"image_diff\": { \"frames\": %d, \"frames_differing\": %d, \"pixels_differing\": %.6f, \"worst_frame\": %.6f }",
+                diff->frames, diff->framesDiffering, diff->pixels > 0 ? diff->pixelsDiffering / diff->pixels : 0, diff->worstFrame);
+        }
+        fprintf(out, "\n}\n");
+        return;
+    }
+
+    fprintf(out, "stage,min_ms,mean_ms,p50_ms,p99_ms,max_ms,stddev_ms\n");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        if (!sampleCounts[s]) continue;
+        fprintf(out, "%s,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+            stageNames[s], stages[s].min, stages[s].mean, stages[s].p50, stages[s].p99, stages[s].max, stages[s].stddev);
+    }
+
+    // comment lines keep the table readable as plain CSV
+    if (resolution.targetMs > 0) {
+        fprintf(out, "# resolution budget_ms=%.2f changes=%d in_budget=%.4f", resolution.targetMs, resolution.changes, inBudget);
+        for (int l = 0; l < RES_LEVEL_COUNT; l++) {
+            int w, h;
+            ResolutionLevelSize(l, &w, &h);
+            fprintf(out, " %dx%d=%d", w, h, resolution.framesAtLevel[l]);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "# pipeline %s\n", renderPipelines[renderPipeline].name);
+    fprintf(out, "# visibility sectors=%d sectors_visited_mean=%.1f sectors_visited_max=%d walls=%d walls_visited_mean=%.1f walls_visited_max=%d sprites=%d sprites_visible_mean=%.1f\n",
+        level.sectorCount, visited->sectors / frames, visited->maxSectors, level.wallCount, visited->walls / frames, visited->maxWalls,
+        sprites.count, visited->spritesVisible / frames);
+    if (actors.count > 0) {
+        fprintf(out, "# actors count=%d actor_ticks_per_s=%.0f state_hash=%016llx\n",
+            actors.count, actors.count / (stages[STAGE_ACTORS].mean / 1000.0), static_cast<unsigned long long>(HashActors()));
+    }
+    fprintf(out, "# assets first_frame_ms=%.2f ready_ms=%.2f hits=%llu misses=%llu evictions=%llu loads=%llu failures=%llu bytes_peak=%zu decode_ms=%.2f\n",
+        firstFrameMs, assetStats.readyMs, static_cast<unsigned long long>(assetStats.hits), static_cast<unsigned long long>(assetStats.misses),
+        static_cast<unsigned long long>(assetStats.evictions), static_cast<unsigned long long>(assetStats.loads),
+        static_cast<unsigned long long>(assetStats.failures), assetStats.bytesPeak, assetStats.decodeMs);
+    if (sampleCounts[STAGE_CAPTURE]) {
+        fprintf(out, "# capture frames=%d written=%d dropped=%d write_ms_mean=%.4f\n",
+            captureStats.frames, captureStats.written, captureStats.dropped, captureStats.written > 0 ? captureStats.writeMs / captureStats.written : 0);
+    }
+    if (runHash) fprintf(out, "# run_hash %s\n", runHash);
+    if (diff) {
+        fprintf(out, "# image_diff frames=%d frames_differing=%d pixels_differing=%.6f worst_frame=%.6f\n",
+            diff->frames, diff->framesDiffering, diff->pixels > 0 ? diff->pixelsDiffering / diff->pixels : 0, diff->worstFrame);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Uint64 processStart = SDL_GetPerformanceCounter();
+    int bench = 0, frames = 1000, json = 0;
+    float frameBudgetMs = 0;
+    int realtime = 0;
+    double frameCap = 0;
+    const char* demoFile = NULL;
+    const char* recordFile = NULL;
+    const char* hashFile = NULL;
+    const char* saveFramesFile = NULL;
+    const char* diffFramesFile = NULL;
+    int threads = SDL_GetCPUCount();
+    const char* pathFile = NULL;
+    const char* levelFile = DEFAULT_LEVEL;
+    const char* outFile = NULL;
+    const char* traceFile = NULL;
+    const char* textureFile = NULL;
+    int spriteCount = 0;
+    const char* spriteFile = NULL;
+    int actorCount = 0;
+    int simOnly = 0;
+    double assetBudgetMb = -1;
+    const char* captureFile = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) bench = 1;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) pathFile = argv[++i];
+        else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) levelFile = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) json = strcmp(argv[++i], "json") == 0;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outFile = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) traceFile = argv[++i];
+        else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc) textureFile = argv[++i];
+        else if (strcmp(argv[i], "--flat") == 0) texturedWalls = 0;
+        else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc) frameBudgetMs = atof(argv[++i]);
+        else if (strcmp(argv[i], "--realtime") == 0) realtime = 1;
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) frameCap = atof(argv[++i]);
+        else if (strcmp(argv[i], "--demo") == 0 && i + 1 < argc) demoFile = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordFile = argv[++i];
+        else if (strcmp(argv[i], "--hashes") == 0 && i + 1 < argc) hashFile = argv[++i];
+        else if (strcmp(argv[i], "--save-frames") == 0 && i + 1 < argc) saveFramesFile = argv[++i];
+        else if (strcmp(argv[i], "--diff-frames") == 0 && i + 1 < argc) diffFramesFile = argv[++i];
+        else if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc) spriteCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sprite") == 0 && i + 1 < argc) spriteFile = argv[++i];
+        else if (strcmp(argv[i], "--actors") == 0 && i + 1 < argc) actorCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sim-only") == 0) simOnly = 1;
+        else if (strcmp(argv[i], "--asset-budget-mb") == 0 && i + 1 < argc) assetBudgetMb = atof(argv[++i]);
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) captureFile = argv[++i];
+        else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            renderPipeline = FindRenderPipeline(argv[++i]);
+            if (renderPipeline < 0) {
+                fprintf(stderr, "No render pipeline called %s\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    if (!bench || frames < 1) {
+        fprintf(stderr, "usage: %s --bench [--map file] [--frames N] [--path file] [--threads N] [--format csv|json] [--out file] [--trace file] [--texture file] [--flat] [--budget-ms N] [--realtime] [--fps N] [--demo file] [--record file] [--hashes file] [--save-frames file] [--diff-frames file] [--sprites N] [--sprite file] [--actors N] [--sim-only] [--asset-budget-mb N] [--capture file] [--pipeline name]\n", argv[0]);
+        return 1;
+    }
+
+    if (pathFile) {
+        if (!LoadCameraPath(pathFile)) {
+            fprintf(stderr, "Could not read camera path %s\n", pathFile);
+            return 1;
+        }
+    } else {
+        UseBuiltinPath();
+    }
+
+    if (!Init(levelFile, textureFile)) return 1;
+    if (assetBudgetMb >= 0) SetAssetBudget(static_cast<size_t>(assetBudgetMb * 1024 * 1024));
+    // frames compared against other runs must not depend on when the loader finishes
+    if (hashFile || saveFramesFile || diffFramesFile) WaitForAssets();
+    if (spriteCount > 0) {
+        InitSprites(spriteFile, spriteCount);
+        int placed = ScatterSprites(spriteCount, 1);
+        if (placed < spriteCount) fprintf(stderr, "Only found room for %d of %d sprites\n", placed, spriteCount);
+    }
+    if (actorCount > 0) {
+        InitActors(actorCount);
+        int placed = SpawnActors(actorCount, 1);
+        if (placed < actorCount) fprintf(stderr, "Only found room for %d of %d actors\n", placed, actorCount);
+    }
+    if (demoFile) {
+        if (!DemoLoad(demoFile)) return 1;
+        if (static_cast<int>(demo.header.tickCount) < frames) frames = demo.header.tickCount;
+        if (frames < 1) {
+            fprintf(stderr, "Demo %s is empty\n", demoFile);
+            return 1;
+        }
+    }
+
+    FILE* hashes = NULL;
+    if (hashFile && !(hashes = fopen(hashFile, "w"))) {
+        fprintf(stderr, "Could not open %s\n", hashFile);
+        return 1;
+    }
+    Uint64 runHash = 1469598103934665603ull;
+
+    FILE* savedFrames = saveFramesFile ? fopen(saveFramesFile, "wb") : NULL;
+    FILE* referenceFrames = diffFramesFile ? fopen(diffFramesFile, "rb") : NULL;
+    if ((saveFramesFile && !savedFrames) || (diffFramesFile && !referenceFrames)) {
+        fprintf(stderr, "Could not open %s\n", saveFramesFile && !savedFrames ? saveFramesFile : diffFramesFile);
+        return 1;
+    }
+    Uint8* reference = referenceFrames ? static_cast<Uint8*>(malloc(WINDOW_W * WINDOW_H)) : NULL;
+    ImageDiff diff;
+    memset(&diff, 0, sizeof(diff));
+    VisibilitySummary visited;
+    memset(&visited, 0, sizeof(visited));
+
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    double* samples[STAGE_COUNT];
+    int sampleCounts[STAGE_COUNT];
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        int size = s == STAGE_LATENCY ? MAX_INPUT_EVENTS : frames;
+        samples[s] = static_cast<double*>(malloc(size * sizeof(double)));
+        sampleCounts[s] = s >= STAGE_LOAD ? 1 : frames;
+    }
+    sampleCounts[STAGE_INTERVAL] = sampleCounts[STAGE_LATENCY] = 0;
+    if (!actors.count) sampleCounts[STAGE_ACTORS] = 0;
+    if (!captureFile) sampleCounts[STAGE_CAPTURE] = 0;
+    if (simOnly) {
+        for (int s = STAGE_COLLISION; s < STAGE_FRAME; s++) sampleCounts[s] = 0;
+    }
+
+    samples[STAGE_LOAD][0] = loadStats.levelMs;
+    samples[STAGE_BSP_BUILD][0] = loadStats.bspBuildMs;
+    samples[STAGE_GRID_BUILD][0] = loadStats.gridBuildMs;
+
+    JobsInit(threads);
+    ResolutionInit(frameBudgetMs);
+    // the video plays at --fps, or the usual 60 when there is none
+    if (captureFile && !StartCapture(captureFile, WINDOW_W, WINDOW_H, frameCap > 0 ? static_cast<int>(frameCap) : 60)) return 1;
+    float frameTime = 1.0f / 60.0f;
+    runStart = SDL_GetPerformanceCounter();
+    SimInit();
+    if (recordFile) DemoRecordStart();
+    double lastFrameEnd = 0;
+    double firstFrameMs = 0;
+
+    for (int f = 0; f < frames; f++) {
+        CameraKey key = SamplePath(f, frames);
+        Uint64 t[STAGE_COUNT + 1];
+        PROFILE_FRAME();
+        BeginFrame();
+
+        t[0] = SDL_GetPerformanceCounter();
+        ActorsTick(static_cast<float>(SIM_DT));
+        t[1] = SDL_GetPerformanceCounter();
+        if (simOnly) {
+            samples[STAGE_ACTORS][f] = samples[STAGE_FRAME][f] = (t[1] - t[0]) * toMs;
+            continue;
+        }
+
+        if (realtime) {
+            SimAdvance(ScriptedInput, NULL);
+            viewCam = SimViewCamera();
+        } else if (demoFile) {
+            SimTick(DemoInput(NULL));
+            viewCam = cam;
+        } else {
+            cam.oldCamPos = cam.camPos;
+            cam.camPos.x = key.x;
+            cam.camPos.y = key.y;
+            cam.camAngle = key.angle;
+            cam.stepWave += 3 * frameTime;
+            if (cam.stepWave > M_PI*2) cam.stepWave = 0;
+            CollisionDetection(frameTime);
+            viewCam = cam;
+        }
+
+        t[2] = SDL_GetPerformanceCounter();
+        TransformVertices(&viewCam);
+        t[3] = SDL_GetPerformanceCounter();
+        ProjectWalls();
+        t[4] = SDL_GetPerformanceCounter();
+        visited.sectors += visibility.sectorsVisited;
+        visited.walls += visibility.wallsVisited;
+        if (visibility.sectorsVisited > visited.maxSectors) visited.maxSectors = visibility.sectorsVisited;
+        if (visibility.wallsVisited > visited.maxWalls) visited.maxWalls = visibility.wallsVisited;
+        ProjectSprites();
+        t[5] = SDL_GetPerformanceCounter();
+        visited.spritesVisible += sprites.visibleCount;
+        Rasterize();
+        t[6] = SDL_GetPerformanceCounter();
+        ExpandFrame();
+        t[7] = SDL_GetPerformanceCounter();
+        CaptureFrame();
+        t[8] = SDL_GetPerformanceCounter();
+
+        for (int s = 0; s < STAGE_FRAME; s++) samples[s][f] = (t[s + 1] - t[s]) * toMs;
+        samples[STAGE_FRAME][f] = (t[STAGE_FRAME] - t[0]) * toMs;
+        ResolutionUpdate(samples[STAGE_FRAME][f]);
+        if (f == 0) firstFrameMs = (t[STAGE_FRAME] - processStart) * toMs;
+
+        int pixels = screenW * screenH;
+        if (savedFrames) fwrite(indexBuffer, 1, pixels, savedFrames);
+        if (reference && fread(reference, 1, pixels, referenceFrames) == static_cast<size_t>(pixels)) {
+            int differing = 0;
+            for (int i = 0; i < pixels; i++) differing += indexBuffer[i] != reference[i];
+            diff.frames++;
+            diff.framesDiffering += differing > 0;
+            diff.pixels += pixels;
+            diff.pixelsDiffering += differing;
+            if (static_cast<double>(differing) / pixels > diff.worstFrame) diff.worstFrame = static_cast<double>(differing) / pixels;
+        }
+
+        if (hashes) {
+            Uint64 hash = HashFrame();
+            fprintf(hashes, "%016llx\n", static_cast<unsigned long long>(hash));
+            runHash = (runHash ^ hash) * 1099511628211ull;
+        }
+
+        if (realtime) {
+            // the frame counts as on screen once pacing lets it go, like a vsync flip
+            if (frameCap > 0) PaceFrame(frameCap);
+            double frameEnd = RunSeconds();
+            if (f > 0) samples[STAGE_INTERVAL][sampleCounts[STAGE_INTERVAL]++] = (frameEnd - lastFrameEnd) * 1000.0;
+            lastFrameEnd = frameEnd;
+
+            for (; inputEventsShown < inputEventsSampled && inputEvents[inputEventsShown].tick <= sim.ticks; inputEventsShown++) {
+                samples[STAGE_LATENCY][sampleCounts[STAGE_LATENCY]++] = (frameEnd - inputEvents[inputEventsShown].time) * 1000.0;
+            }
+        }
+    }
+
+    PROFILE_FRAME();
+#ifdef DOOM_PROFILE
+    if (traceFile && !ProfileWriteTrace(traceFile, PROFILE_TRACE_FRAMES)) fprintf(stderr, "Could not write %s\n", traceFile);
+#else
+    if (traceFile) fprintf(stderr, "Built without DOOM_PROFILE, no trace written\n");
+#endif
+
+    char runHashText[17];
+    if (hashes) {
+        snprintf(runHashText, sizeof(runHashText), "%016llx", static_cast<unsigned long long>(runHash));
+        fclose(hashes);
+    }
+    if (savedFrames) fclose(savedFrames);
+    if (referenceFrames) {
+        if (diff.frames < frames) fprintf(stderr, "%s only held %d of %d frames\n", diffFramesFile, diff.frames, frames);
+        fclose(referenceFrames);
+        free(reference);
+    }
+    if (recordFile && !DemoSave(recordFile)) {
+        JobsShutdown();
+        Shutdown();
+        return 1;
+    }
+    DemoFree();
+    StopCapture();
+
+    StageSummary stages[STAGE_COUNT];
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        if (sampleCounts[s]) stages[s] = Summarize(samples[s], sampleCounts[s]);
+        free(samples[s]);
+    }
+
+    FILE* out = outFile ? fopen(outFile, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Could not open %s\n", outFile);
+        JobsShutdown();
+        Shutdown();
+        return 1;
+    }
+    WriteReport(out, json, frames, stages, sampleCounts, hashes ? runHashText : NULL, referenceFrames ? &diff : NULL, &visited, firstFrameMs);
+    if (out != stdout) fclose(out);
+
+    JobsShutdown();
+    Shutdown();
+    return 0;
+}
@@ -0,0 +1,904 @@
+// Kernel microbenchmarks on synthetic data built in memory, no map files or
+// window needed. Every kernel runs once untimed to warm the caches, then
+// --reps times, and reports the median and fastest time per op plus the
+// throughput at the median. What size and op mean depends on the kernel:
+//
+//   geometry kernels   size is the input count, an op is one call
+//   collision_*        the same circle tests against every wall or the walls of
+//                      the grid cells, size is the wall count and an op is one query
+//   sincos_*           cosine and sine of an angle from libm or from the fixed
+//                      point table, size is the input count and an op is one pair
+//   reciprocal_*       1 / z as a float divide or from the fixed point table
+//   project            size is the wall count, an op is one frame of transform
+//                      and BSP projection from a random spot
+//   raster_*           one frame of every wall pipeline, projected and drawn at
+//                      the window size from the same spots of a pillar level,
+//                      size is the pixels of a frame and an op is one pixel
+//   transform_*        size is the vertex count, an op is one vertex
+//   wallfill_*         a full 1152x758 frame of wall columns, an op is one pixel
+//   expand_*           the same frame from palette indices to colors
+//   yuv_*              the same frame from colors to the 4:2:0 YUV of --capture
+//   sort_*             sprite depths farthest first, by the radix sort of the
+//                      sprite pass or by std::stable_sort, size is the sprite
+//                      count and an op is one sprite
+//
+// usage: DOOM_bench [--reps N] [--filter text] [--format csv|json] [--out file]
+//
+// --filter only runs kernels whose name contains the text. The vector kernels are
+// checked against the scalar ones and the exit code is 1 on any mismatch.
+
+#include "bsp.hpp"
+#include "capture.hpp"
+#include "cpu.hpp"
+#include "engine.hpp"
+#include "fixed.hpp"
+#include "grid.hpp"
+#include "palette.hpp"
+#include "sprite.hpp"
+#include "transform.hpp"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#undef main
+
+#define DEFAULT_REPETITIONS 5
+#define MAX_RESULTS 256
+#define GEOMETRY_OPS_PER_RUN 4000000.0
+#define COLLISION_TESTS_PER_RUN 10000000.0 // queries are cut down to about this many brute force wall tests
+#define COLLISION_RADIUS 10.0f
+#define PROJECT_FRAMES_PER_RUN 200
+#define RASTER_FRAMES_PER_RUN 20
+#define RASTER_WALLS 16384
+#define TRANSFORMS_PER_RUN 40000000.0      // vertices pushed through each transform kernel per size
+#define WALLFILL_FRAMES 40
+#define WALLFILL_W 1152
+#define WALLFILL_H 758
+#define POLY_VERTS 16 // of the polygon point_in_poly tests against
+#define SORTED_PER_RUN 4000000.0
+
+static const int geometryCounts[] = { 256, 4096, 65536, 1048576 };
+static const int wallCounts[] = { 64, 1024, 16384, 131072, 524288 };
+static const int projectWallCounts[] = { 1024, 16384, 131072 };
+static const int vertexCounts[] = { 1024, 16384, 262144, 1048576 };
+static const int spriteCounts[] = { 1000, 10000, 100000 };
+
+typedef struct {
+    char kernel[32];
+    int size;
+    double ops;        // per timed run
+    double nsPerOp;    // median of the runs
+    double minNsPerOp;
+} BenchResult;
+
+typedef void (*BenchRun)(void* userData);
+
+static BenchResult results[MAX_RESULTS];
+static int resultCount;
+static int repetitions = DEFAULT_REPETITIONS;
+static const char* filter;
+
+// Results go through these so the compiler can not drop the work
+static volatile Uint32 intSink;
+static volatile float floatSink;
+
+static Uint32 rngState = 12345;
+
+static float RandomFloat(float lo, float hi) {
+    rngState = rngState * 1664525 + 1013904223;
+    return lo + (hi - lo) * ((rngState >> 8) / 16777216.0f);
+}
+
+static Uint32 Align(Uint32 offset) {
+    return (offset + LEVEL_ALIGN - 1) & ~(LEVEL_ALIGN - 1);
+}
+
+// The same grid of square pillars DOOM_mapconv --generate writes, laid out in a
+// level file image so LoadLevelFromMemory can use it in place
+static void BuildPillarLevel(int wallCount, std::vector<Uint8>* image, float* extent) {
+    const float spacing = 80, size = 30;
+    int pillars = (wallCount + 3) / 4;
+    int side = 1;
+    while (side * side < pillars) side++;
+
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.vertexCount = pillars * 4;
+    header.wallCount = pillars * 4;
+    header.polyCount = pillars;
+    header.vertexOffset = Align(sizeof(LevelHeader));
+    header.wallOffset = Align(header.vertexOffset + header.vertexCount * sizeof(Vec2));
+    header.polyOffset = Align(header.wallOffset + header.wallCount * sizeof(LevelWall));
+    header.fileSize = header.polyOffset + header.polyCount * sizeof(LevelPoly);
+
+    image->assign(header.fileSize, 0);
+    Uint8* data = image->data();
+    memcpy(data, &header, sizeof(header));
+    Vec2* verts = reinterpret_cast<Vec2*>(data + header.vertexOffset);
+    LevelWall* walls = reinterpret_cast<LevelWall*>(data + header.wallOffset);
+    LevelPoly* polys = reinterpret_cast<LevelPoly*>(data + header.polyOffset);
+
+    static const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+    for (int i = 0; i < pillars; i++) {
+        float x = (i % side) * spacing, y = (i / side) * spacing;
+        for (int c = 0; c < 4; c++) {
+            verts[i * 4 + c].x = x + corners[c][0] * size;
+            verts[i * 4 + c].y = y + corners[c][1] * size;
+            walls[i * 4 + c].v1 = i * 4 + c;
+            walls[i * 4 + c].v2 = i * 4 + (c + 1) % 4;
+            walls[i * 4 + c].poly = i;
+        }
+        polys[i].firstVertex = polys[i].firstWall = i * 4;
+        polys[i].vertexCount = polys[i].wallCount = 4;
+        polys[i].height = 1000;
+    }
+
+    *extent = side * spacing;
+}
+
+// Every query is one frame of walking: a short step on from the last position,
+// with a jump to a random spot every 256 queries so the whole level gets covered
+static void RandomMove(float extent, int query, Vec2* from, Vec2* to) {
+    static Vec2 pos;
+    if (query % 256 == 0) {
+        pos.x = RandomFloat(0, extent);
+        pos.y = RandomFloat(0, extent);
+    }
+
+    *from = pos;
+    pos.x += RandomFloat(-2, 2);
+    pos.y += RandomFloat(-2, 2);
+    *to = pos;
+}
+
+static int Selected(const char* kernel) {
+    return !filter || strstr(kernel, filter);
+}
+
+static int CompareDouble(const void* a, const void* b) {
+    double da = *static_cast<const double*>(a), db = *static_cast<const double*>(b);
+    return (da > db) - (da < db);
+}
+
+// One untimed run, then the timed ones, ops is how many ops one run does
+static void Measure(const char* kernel, int size, double ops, BenchRun run, void* userData) {
+    if (!Selected(kernel) || resultCount == MAX_RESULTS) return;
+    run(userData);
+
+    double* ns = static_cast<double*>(malloc(repetitions * sizeof(double)));
+    for (int r = 0; r < repetitions; r++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        run(userData);
+        double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        ns[r] = seconds * 1e9 / ops;
+    }
+    qsort(ns, repetitions, sizeof(double), CompareDouble);
+
+    BenchResult* result = &results[resultCount++];
+    snprintf(result->kernel, sizeof(result->kernel), "%s", kernel);
+    result->size = size;
+    result->ops = ops;
+    result->nsPerOp = ns[repetitions / 2];
+    result->minNsPerOp = ns[0];
+    free(ns);
+
+    fprintf(stderr, "%-28s %9d %10.3f ns/op\n", kernel, size, result->nsPerOp);
+}
+
+// Random segments a-b with c near them and d a step away from c, so collision and
+// closest point kernels see both hits and misses
+typedef struct {
+    int count;
+    int passes;
+    Vec2* a;
+    Vec2* b;
+    Vec2* c;
+    Vec2* d;
+    float polyX[POLY_VERTS];
+    float polyY[POLY_VERTS];
+} GeometryInput;
+
+static void BuildGeometryInput(GeometryInput* in, int count) {
+    in->count = count;
+    in->passes = static_cast<int>(GEOMETRY_OPS_PER_RUN / count);
+    if (in->passes < 1) in->passes = 1;
+    in->a = static_cast<Vec2*>(malloc(count * sizeof(Vec2)));
+    in->b = static_cast<Vec2*>(malloc(count * sizeof(Vec2)));
+    in->c = static_cast<Vec2*>(malloc(count * sizeof(Vec2)));
+    in->d = static_cast<Vec2*>(malloc(count * sizeof(Vec2)));
+
+    for (int i = 0; i < count; i++) {
+        in->a[i].x = RandomFloat(0, 1000);
+        in->a[i].y = RandomFloat(0, 1000);
+        in->b[i].x = in->a[i].x + RandomFloat(-100, 100);
+        in->b[i].y = in->a[i].y + RandomFloat(-100, 100);
+        in->c[i].x = (in->a[i].x + in->b[i].x) / 2 + RandomFloat(-30, 30);
+        in->c[i].y = (in->a[i].y + in->b[i].y) / 2 + RandomFloat(-30, 30);
+        in->d[i].x = in->c[i].x + RandomFloat(-2, 2);
+        in->d[i].y = in->c[i].y + RandomFloat(-2, 2);
+    }
+
+    // a wobbly star around the middle of the points
+    for (int v = 0; v < POLY_VERTS; v++) {
+        float angle = v * 2 * static_cast<float>(M_PI) / POLY_VERTS;
+        float radius = v & 1 ? 250 : 450;
+        in->polyX[v] = 500 + radius * cosf(angle);
+        in->polyY[v] = 500 + radius * sinf(angle);
+    }
+}
+
+static void FreeGeometryInput(GeometryInput* in) {
+    free(in->a);
+    free(in->b);
+    free(in->c);
+    free(in->d);
+}
+
+static LineSeg InputLine(const GeometryInput* in, int i) {
+    LineSeg line;
+    line.p1 = in->a[i];
+    line.p2 = in->b[i];
+    return line;
+}
+
+static void RunPointInPoly(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    Uint32 hits = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) hits += PointInPoly(POLY_VERTS, in->polyX, in->polyY, in->c[i].x, in->c[i].y);
+    }
+    intSink = hits;
+}
+
+static void RunIntersection(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    float sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) {
+            Vec2 hit = Intersection(in->a[i].x, in->a[i].y, in->b[i].x, in->b[i].y, in->c[i].x, in->c[i].y, in->d[i].x, in->d[i].y);
+            sum += hit.x;
+        }
+    }
+    floatSink = sum;
+}
+
+static void RunIsFrontFace(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    Uint32 sides = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sides += IsFrontFace(in->c[i], in->a[i], in->b[i]);
+    }
+    intSink = sides;
+}
+
+static void RunClosestPointOnLine(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    float sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sum += ClosestPointOnLine(InputLine(in, i), in->c[i]).x;
+    }
+    floatSink = sum;
+}
+
+static void RunIsPointOnLine(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    Uint32 hits = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) hits += IsPointOnLine(InputLine(in, i), in->c[i]);
+    }
+    intSink = hits;
+}
+
+static void RunLineCircleCollision(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    Uint32 hits = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) hits += LineCircleCollision(InputLine(in, i), in->c[i], 10.0f);
+    }
+    intSink = hits;
+}
+
+static void RunResolveCollision(void* userData) {
+    GeometryInput* in = static_cast<GeometryInput*>(userData);
+    float sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sum += ResolveCollision(in->d[i], in->c[i], InputLine(in, i), 1.0f / 60.0f).x;
+    }
+    floatSink = sum;
+}
+
+static void BenchGeometry() {
+    static const struct {
+        const char* name;
+        BenchRun run;
+    } kernels[] = {
+        { "point_in_poly", RunPointInPoly },
+        { "intersection", RunIntersection },
+        { "is_front_face", RunIsFrontFace },
+        { "closest_point_on_line", RunClosestPointOnLine },
+        { "is_point_on_line", RunIsPointOnLine },
+        { "line_circle_collision", RunLineCircleCollision },
+        { "resolve_collision", RunResolveCollision },
+    };
+
+    for (int count : geometryCounts) {
+        GeometryInput in;
+        BuildGeometryInput(&in, count);
+        for (const auto& kernel : kernels) Measure(kernel.name, count, static_cast<double>(in.passes) * count, kernel.run, &in);
+        FreeGeometryInput(&in);
+    }
+}
+
+typedef struct {
+    int count;
+    int passes;
+    float* angles;
+    float* floatZ;
+    Uint32* fixedZ;
+} FixedInput;
+
+static void RunSinCosLibm(void* userData) {
+    FixedInput* in = static_cast<FixedInput*>(userData);
+    float sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sum += cosf(in->angles[i]) + sinf(in->angles[i]);
+    }
+    floatSink = sum;
+}
+
+static void RunSinCosTable(void* userData) {
+    FixedInput* in = static_cast<FixedInput*>(userData);
+    Fixed sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) {
+            Angle angle = AngleFromRadians(in->angles[i]);
+            sum += FixedCos(angle) + FixedSin(angle);
+        }
+    }
+    intSink = sum;
+}
+
+static void RunReciprocalDivide(void* userData) {
+    FixedInput* in = static_cast<FixedInput*>(userData);
+    float sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sum += 1.0f / in->floatZ[i];
+    }
+    floatSink = sum;
+}
+
+static void RunReciprocalTable(void* userData) {
+    FixedInput* in = static_cast<FixedInput*>(userData);
+    Uint32 sum = 0;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) sum += Reciprocal(in->fixedZ[i], 43);
+    }
+    intSink = sum;
+}
+
+// What the DOOM_FIXED_POINT backend swaps in for libm and the divide, on angles
+// anywhere in a few turns and z from the near plane out to the far end of a level
+static void BenchFixed() {
+    for (int count : geometryCounts) {
+        FixedInput in;
+        in.count = count;
+        in.passes = static_cast<int>(GEOMETRY_OPS_PER_RUN / count);
+        if (in.passes < 1) in.passes = 1;
+        in.angles = static_cast<float*>(malloc(count * sizeof(float)));
+        in.floatZ = static_cast<float*>(malloc(count * sizeof(float)));
+        in.fixedZ = static_cast<Uint32*>(malloc(count * sizeof(Uint32)));
+        for (int i = 0; i < count; i++) {
+            in.angles[i] = RandomFloat(-20, 20);
+            in.floatZ[i] = RandomFloat(0.1f, 5000);
+            in.fixedZ[i] = FloatToFixed(in.floatZ[i]);
+        }
+
+        double ops = static_cast<double>(in.passes) * count;
+        Measure("sincos_libm", count, ops, RunSinCosLibm, &in);
+        Measure("sincos_table", count, ops, RunSinCosTable, &in);
+        Measure("reciprocal_divide", count, ops, RunReciprocalDivide, &in);
+        Measure("reciprocal_table", count, ops, RunReciprocalTable, &in);
+
+        free(in.angles);
+        free(in.floatZ);
+        free(in.fixedZ);
+    }
+}
+
+typedef struct {
+    float extent;
+    int queries;
+    Uint32 seed; // every run walks the same queries from here
+    Vec2 pos;
+    Uint32 hits; // walls within the radius, summed over the queries of a run
+} CollisionInput;
+
+static void RunCollisionBrute(void* userData) {
+    CollisionInput* in = static_cast<CollisionInput*>(userData);
+    rngState = in->seed;
+    Uint32 hits = 0;
+    for (int q = 0; q < in->queries; q++) {
+        Vec2 from, to;
+        RandomMove(in->extent, q, &from, &to);
+        for (int w = 0; w < level.wallCount; w++) {
+            LineSeg line;
+            line.p1 = level.verts[level.walls[w].v1];
+            line.p2 = level.verts[level.walls[w].v2];
+            hits += LineCircleCollision(line, to, COLLISION_RADIUS);
+        }
+    }
+    in->hits = hits;
+}
+
+static void CountGridHit(int w, void* userData) {
+    CollisionInput* in = static_cast<CollisionInput*>(userData);
+    LineSeg line;
+    line.p1 = level.verts[level.walls[w].v1];
+    line.p2 = level.verts[level.walls[w].v2];
+    in->hits += LineCircleCollision(line, in->pos, COLLISION_RADIUS);
+}
+
+static void RunCollisionGrid(void* userData) {
+    CollisionInput* in = static_cast<CollisionInput*>(userData);
+    rngState = in->seed;
+    in->hits = 0;
+    for (int q = 0; q < in->queries; q++) {
+        Vec2 from;
+        RandomMove(in->extent, q, &from, &in->pos);
+        Vec2 boxMin = { in->pos.x - COLLISION_RADIUS, in->pos.y - COLLISION_RADIUS };
+        Vec2 boxMax = { in->pos.x + COLLISION_RADIUS, in->pos.y + COLLISION_RADIUS };
+        QueryWallGrid(boxMin, boxMax, CountGridHit, in);
+    }
+}
+
+// The same queries and the same circle test against every wall or against the
+// walls of the grid cells around the circle, so both have to find the same hits
+static int BenchCollision() {
+    if (!Selected("collision_brute") && !Selected("collision_grid")) return 1;
+    int ok = 1;
+
+    for (int wallCount : wallCounts) {
+        std::vector<Uint8> image;
+        CollisionInput in;
+        BuildPillarLevel(wallCount, &image, &in.extent);
+        if (!LoadLevelFromMemory(image.data(), image.size())) return 0;
+        BuildWallGrid();
+
+        in.queries = static_cast<int>(COLLISION_TESTS_PER_RUN / level.wallCount);
+        if (in.queries < 100) in.queries = 100;
+        in.seed = rngState;
+        Measure("collision_brute", level.wallCount, in.queries, RunCollisionBrute, &in);
+        Uint32 reference = in.hits;
+        Measure("collision_grid", level.wallCount, in.queries, RunCollisionGrid, &in);
+        if (Selected("collision_brute") && Selected("collision_grid") && reference != in.hits) {
+            fprintf(stderr, "collision_grid found %u hits, collision_brute %u\n", in.hits, reference);
+            ok = 0;
+        }
+
+        FreeWallGrid();
+        UnloadLevel();
+    }
+    return ok;
+}
+
+static void RunProject(void* userData) {
+    float extent = *static_cast<float*>(userData);
+    Uint32 walls = 0;
+    for (int f = 0; f < PROJECT_FRAMES_PER_RUN; f++) {
+        // between the pillars, looking any way
+        viewCam.camPos.x = static_cast<int>(RandomFloat(0, extent / 80)) * 80.0f + 55;
+        viewCam.camPos.y = static_cast<int>(RandomFloat(0, extent / 80)) * 80.0f + 55;
+        viewCam.camAngle = RandomFloat(0, 2 * static_cast<float>(M_PI));
+        BeginFrame();
+        TransformVertices(&viewCam);
+        ProjectWalls();
+        walls += screenSpaceVisiblePlanes;
+    }
+    intSink = walls;
+}
+
+// The projection half of Render(): transform plus the BSP walk that clips,
+// projects and occludes the walls, over pillar levels of growing size
+static int BenchProject() {
+    if (!Selected("project")) return 1;
+
+    AllocRenderBuffers();
+    for (int wallCount : projectWallCounts) {
+        std::vector<Uint8> image;
+        float extent;
+        BuildPillarLevel(wallCount, &image, &extent);
+        if (!LoadLevelFromMemory(image.data(), image.size()) || !BuildBsp()) return 0;
+        AllocTransformBuffers();
+
+        Measure("project", level.wallCount, PROJECT_FRAMES_PER_RUN, RunProject, &extent);
+
+        FreeTransformBuffers();
+        FreeBsp();
+        UnloadLevel();
+    }
+    FreeRenderBuffers();
+    return 1;
+}
+
+typedef struct {
+    float extent;
+    Uint32 seed;
+} RasterInput;
+
+static void RunRaster(void* userData) {
+    RasterInput* in = static_cast<RasterInput*>(userData);
+    rngState = in->seed;
+    for (int f = 0; f < RASTER_FRAMES_PER_RUN; f++) {
+        viewCam.camPos.x = static_cast<int>(RandomFloat(0, in->extent / 80)) * 80.0f + 55;
+        viewCam.camPos.y = static_cast<int>(RandomFloat(0, in->extent / 80)) * 80.0f + 55;
+        viewCam.camAngle = RandomFloat(0, 2 * static_cast<float>(M_PI));
+        BeginFrame();
+        TransformVertices(&viewCam);
+        ProjectWalls();
+        Rasterize();
+    }
+    intSink = indexBuffer[screenW * screenH / 2];
+}
+
+// Every wall pipeline in the table over the same frames, so the variants can be
+// compared side by side. The projection is in every one of them and costs the
+// same, the differences are the raster stage.
+static int BenchRaster() {
+    char name[32];
+    int any = 0;
+    for (int p = 0; p < renderPipelineCount; p++) {
+        snprintf(name, sizeof(name), "raster_%s", renderPipelines[p].name);
+        any |= Selected(name);
+    }
+    if (!any) return 1;
+
+    AllocRenderBuffers();
+    SetRenderResolution(WINDOW_W, WINDOW_H);
+    MakeFallbackTexture(&wallTexture);
+    std::vector<Uint8> image;
+    RasterInput in;
+    BuildPillarLevel(RASTER_WALLS, &image, &in.extent);
+    if (!LoadLevelFromMemory(image.data(), image.size()) || !BuildBsp()) return 0;
+    AllocTransformBuffers();
+    in.seed = rngState;
+
+    int pixels = screenW * screenH;
+    for (int p = 0; p < renderPipelineCount; p++) {
+        snprintf(name, sizeof(name), "raster_%s", renderPipelines[p].name);
+        if (!Selected(name)) continue;
+        renderPipeline = p;
+        Measure(name, pixels, static_cast<double>(RASTER_FRAMES_PER_RUN) * pixels, RunRaster, &in);
+    }
+    renderPipeline = DEFAULT_RENDER_PIPELINE;
+
+    FreeTransformBuffers();
+    FreeBsp();
+    UnloadLevel();
+    FreeTexture(&wallTexture);
+    FreeRenderBuffers();
+    return 1;
+}
+
+typedef struct {
+    const TransformKernel* kernel;
+    float* world;
+    float* view;
+    int count;
+    int passes;
+} TransformInput;
+
+static void RunTransform(void* userData) {
+    TransformInput* in = static_cast<TransformInput*>(userData);
+    float cosA = cosf(0.7f), sinA = sinf(0.7f);
+    for (int p = 0; p < in->passes; p++) {
+        in->kernel->fn(in->world, in->world + in->count, in->view, in->view + in->count, in->count, 12.5f, -3.0f, cosA, sinA);
+    }
+}
+
+// Runs every transform kernel the CPU supports over the same pool and checks
+// that the vector paths match the scalar one bit for bit
+static int BenchTransform() {
+    int ok = 1;
+
+    for (int count : vertexCounts) {
+        TransformInput in;
+        in.count = count;
+        in.passes = static_cast<int>(TRANSFORMS_PER_RUN / count);
+        in.world = static_cast<float*>(malloc(count * 2 * sizeof(float)));
+        in.view = static_cast<float*>(malloc(count * 2 * sizeof(float)));
+        float* reference = static_cast<float*>(malloc(count * 2 * sizeof(float)));
+        for (int i = 0; i < count * 2; i++) in.world[i] = RandomFloat(-5000, 5000);
+
+        for (int k = 0; k < transformKernelCount; k++) {
+            in.kernel = &transformKernels[k];
+            if (!in.kernel->supported()) continue;
+
+            char name[32];
+            snprintf(name, sizeof(name), "transform_%s", in.kernel->name);
+            if (!Selected(name)) continue;
+            Measure(name, count, static_cast<double>(in.passes) * count, RunTransform, &in);
+
+            if (k == 0) {
+                memcpy(reference, in.view, count * 2 * sizeof(float));
+            } else if (Selected("transform_scalar") && memcmp(reference, in.view, count * 2 * sizeof(float)) != 0) {
+                fprintf(stderr, "%s does not match transform_scalar\n", name);
+                ok = 0;
+            }
+        }
+
+        free(in.world);
+        free(in.view);
+        free(reference);
+    }
+
+    return ok;
+}
+
+typedef struct {
+    int count;
+    int passes;
+    Uint32* depthKeys; // what CullSprites() sorts on, inverted float bits of z
+    Uint32* keys;
+    Uint32* order;
+    Uint32* scratch;
+} SortInput;
+
+static void RunSortRadix(void* userData) {
+    SortInput* in = static_cast<SortInput*>(userData);
+    for (int p = 0; p < in->passes; p++) {
+        memcpy(in->keys, in->depthKeys, in->count * sizeof(Uint32));
+        for (int i = 0; i < in->count; i++) in->order[i] = i;
+        RadixSort(in->keys, in->order, in->scratch, in->scratch + in->count, in->count);
+    }
+}
+
+static void RunSortStd(void* userData) {
+    SortInput* in = static_cast<SortInput*>(userData);
+    const Uint32* keys = in->depthKeys;
+    for (int p = 0; p < in->passes; p++) {
+        for (int i = 0; i < in->count; i++) in->order[i] = i;
+        std::stable_sort(in->order, in->order + in->count, [keys](Uint32 a, Uint32 b) { return keys[a] < keys[b]; });
+    }
+}
+
+// Both sorts are stable, so they have to agree on the order exactly
+static int BenchSort() {
+    int ok = 1;
+
+    for (int count : spriteCounts) {
+        SortInput in;
+        in.count = count;
+        in.passes = static_cast<int>(SORTED_PER_RUN / count);
+        in.depthKeys = static_cast<Uint32*>(malloc(count * sizeof(Uint32)));
+        in.keys = static_cast<Uint32*>(malloc(count * sizeof(Uint32)));
+        in.order = static_cast<Uint32*>(malloc(count * sizeof(Uint32)));
+        in.scratch = static_cast<Uint32*>(malloc(count * 2 * sizeof(Uint32)));
+        Uint32* reference = static_cast<Uint32*>(malloc(count * sizeof(Uint32)));
+        for (int i = 0; i < count; i++) {
+            float z = RandomFloat(SPRITE_NEAR_CLIP, 5000);
+            Uint32 bits;
+            memcpy(&bits, &z, sizeof(bits));
+            in.depthKeys[i] = ~bits;
+        }
+
+        double ops = static_cast<double>(in.passes) * count;
+        Measure("sort_std", count, ops, RunSortStd, &in);
+        memcpy(reference, in.order, count * sizeof(Uint32));
+        Measure("sort_radix", count, ops, RunSortRadix, &in);
+        if (Selected("sort_std") && Selected("sort_radix") && memcmp(reference, in.order, count * sizeof(Uint32)) != 0) {
+            fprintf(stderr, "sort_radix does not match sort_std\n");
+            ok = 0;
+        }
+
+        free(in.depthKeys);
+        free(in.keys);
+        free(in.order);
+        free(in.scratch);
+        free(reference);
+    }
+
+    return ok;
+}
+
+typedef struct {
+    Uint8* frame;
+    Texture texture;
+} WallFillInput;
+
+static void RunWallFillFlat(void* userData) {
+    WallFillInput* in = static_cast<WallFillInput*>(userData);
+    for (int f = 0; f < WALLFILL_FRAMES; f++) {
+        for (int x = 0; x < WALLFILL_W; x++) DrawColumn(in->frame + x, WALLFILL_W, WALLFILL_H, static_cast<Uint8>(f));
+    }
+}
+
+static void RunWallFillTextured(void* userData) {
+    WallFillInput* in = static_cast<WallFillInput*>(userData);
+    const Texture* texture = &in->texture;
+    for (int f = 0; f < WALLFILL_FRAMES; f++) {
+        for (int x = 0; x < WALLFILL_W; x++) {
+            const Uint8* column = texture->mips[0] + ((x + f) & (texture->width - 1)) * texture->height;
+            DrawTexturedColumn(in->frame + x, WALLFILL_W, WALLFILL_H, column, texture->height - 1, 16,
+                WALLFILL_H << 16, 1 << 16, palette.colormaps[LIGHT_LEVELS * 3 / 4]);
+        }
+    }
+}
+
+// Fills every column of a window sized frame top to bottom, once with a flat color
+// and once from the texture at about one texel per pixel, the same column walk
+// the rasterizer does
+static void BenchWallFill() {
+    WallFillInput in;
+    in.frame = static_cast<Uint8*>(malloc(WALLFILL_W * WALLFILL_H));
+    MakeFallbackTexture(&in.texture);
+    double ops = static_cast<double>(WALLFILL_FRAMES) * WALLFILL_W * WALLFILL_H;
+
+    Measure("wallfill_flat", WALLFILL_W * WALLFILL_H, ops, RunWallFillFlat, &in);
+    Measure("wallfill_textured", WALLFILL_W * WALLFILL_H, ops, RunWallFillTextured, &in);
+
+    FreeTexture(&in.texture);
+    free(in.frame);
+}
+
+typedef struct {
+    const ExpandKernel* kernel;
+    Uint8* indices;
+    Uint32* colors;
+    int pixels;
+} ExpandInput;
+
+static void RunExpand(void* userData) {
+    ExpandInput* in = static_cast<ExpandInput*>(userData);
+    for (int f = 0; f < WALLFILL_FRAMES; f++) in->kernel->fn(in->indices, in->colors, in->pixels, palette.colors);
+}
+
+// Runs every expand kernel the CPU supports over the same frame and checks that
+// they all match the scalar one
+static int BenchExpand() {
+    ExpandInput in;
+    in.pixels = WALLFILL_W * WALLFILL_H;
+    in.indices = static_cast<Uint8*>(malloc(in.pixels));
+    in.colors = static_cast<Uint32*>(malloc(in.pixels * sizeof(Uint32)));
+    Uint32* reference = static_cast<Uint32*>(malloc(in.pixels * sizeof(Uint32)));
+    for (int i = 0; i < in.pixels; i++) in.indices[i] = static_cast<Uint8>(RandomFloat(0, 256));
+    int ok = 1;
+
+    for (int k = 0; k < expandKernelCount; k++) {
+        in.kernel = &expandKernels[k];
+        if (!in.kernel->supported()) continue;
+
+        char name[32];
+        snprintf(name, sizeof(name), "expand_%s", in.kernel->name);
+        if (!Selected(name)) continue;
+        Measure(name, in.pixels, static_cast<double>(WALLFILL_FRAMES) * in.pixels, RunExpand, &in);
+
+        if (k == 0) {
+            memcpy(reference, in.colors, in.pixels * sizeof(Uint32));
+        } else if (Selected("expand_scalar") && memcmp(reference, in.colors, in.pixels * sizeof(Uint32)) != 0) {
+            fprintf(stderr, "%s does not match expand_scalar\n", name);
+            ok = 0;
+        }
+    }
+
+    free(in.indices);
+    free(in.colors);
+    free(reference);
+    return ok;
+}
+
+typedef struct {
+    const YuvKernel* kernel;
+    Uint32* colors;
+    Uint8* planes;
+} YuvInput;
+
+static void RunYuv(void* userData) {
+    YuvInput* in = static_cast<YuvInput*>(userData);
+    Uint8* u = in->planes + WALLFILL_W * WALLFILL_H;
+    Uint8* v = u + WALLFILL_W * WALLFILL_H / 4;
+    for (int f = 0; f < WALLFILL_FRAMES; f++) {
+        for (int y = 0; y < WALLFILL_H; y += 2) {
+            in->kernel->fn(in->colors + y * WALLFILL_W, in->colors + (y + 1) * WALLFILL_W, WALLFILL_W,
+                in->planes + y * WALLFILL_W, in->planes + (y + 1) * WALLFILL_W, u + y / 2 * (WALLFILL_W / 2), v + y / 2 * (WALLFILL_W / 2));
+        }
+    }
+}
+
+// Runs every YUV kernel the CPU supports over the same frame of random colors and
+// checks that they all match the scalar one
+static int BenchYuv() {
+    YuvInput in;
+    int pixels = WALLFILL_W * WALLFILL_H;
+    int planeBytes = pixels * 3 / 2;
+    in.colors = static_cast<Uint32*>(malloc(pixels * sizeof(Uint32)));
+    in.planes = static_cast<Uint8*>(malloc(planeBytes));
+    Uint8* reference = static_cast<Uint8*>(malloc(planeBytes));
+    for (int i = 0; i < pixels; i++) in.colors[i] = static_cast<Uint32>(RandomFloat(0, 16777216.0f)) | 0xFF000000;
+    int ok = 1;
+
+    for (int k = 0; k < yuvKernelCount; k++) {
+        in.kernel = &yuvKernels[k];
+        if (!in.kernel->supported()) continue;
+
+        char name[32];
+        snprintf(name, sizeof(name), "yuv_%s", in.kernel->name);
+        if (!Selected(name)) continue;
+        Measure(name, pixels, static_cast<double>(WALLFILL_FRAMES) * pixels, RunYuv, &in);
+
+        if (k == 0) {
+            memcpy(reference, in.planes, planeBytes);
+        } else if (Selected("yuv_scalar") && memcmp(reference, in.planes, planeBytes) != 0) {
+            fprintf(stderr, "%s does not match yuv_scalar\n", name);
+            ok = 0;
+        }
+    }
+
+    free(in.colors);
+    free(in.planes);
+    free(reference);
+    return ok;
+}
+
+void WriteResults(FILE* out, int json) {
+    if (json) {
+        fprintf(out, "{\n  \"repetitions\": %d,\n  \"warmup_runs\": 1,\n  \"avx2\": %d,\n  \"results\": [\n", repetitions, HasAVX2() != 0);
+        for (int i = 0; i < resultCount; i++) {
+            const BenchResult* r = &results[i];
+            fprintf(out, "    { \"kernel\": \"%s\", \"size\": %d, \"ops\": %.0f, \"ns_per_op\": %.4f, \"min_ns_per_op\": %.4f, \"mops_per_s\": %.2f }%s\n",
+                r->kernel, r->size, r->ops, r->nsPerOp, r->minNsPerOp, 1e3 / r->nsPerOp, i + 1 < resultCount ? "," : "");
+        }
+        fprintf(out, "  ]\n}\n");
+        return;
+    }
+
+    fprintf(out, "kernel,size,ops,ns_per_op,min_ns_per_op,mops_per_s\n");
+    for (int i = 0; i < resultCount; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "%s,%d,%.0f,%.4f,%.4f,%.2f\n", r->kernel, r->size, r->ops, r->nsPerOp, r->minNsPerOp, 1e3 / r->nsPerOp);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int json = 0;
+    const char* outFile = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) repetitions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) json = strcmp(argv[++i], "json") == 0;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outFile = argv[++i];
+    }
+
+    if (repetitions < 1) {
+        fprintf(stderr, "usage: %s [--reps N] [--filter text] [--format csv|json] [--out file]\n", argv[0]);
+        return 1;
+    }
+
+    BuildPalette();
+    BuildFixedTables();
+    BenchGeometry();
+    BenchFixed();
+    int ok = BenchCollision();
+    ok = BenchProject() && ok;
+    ok = BenchRaster() && ok;
+    BenchWallFill();
+    ok = BenchExpand() && ok;
+    ok = BenchYuv() && ok;
+    ok = BenchTransform() && ok;
+    ok = BenchSort() && ok;
+
+    FILE* out = outFile ? fopen(outFile, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Could not open %s\n", outFile);
+        return 1;
+    }
+    WriteResults(out, json);
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+#include "actor.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+ActorPool actors;
+static float* actorFloats; // x and y swap with nextX and nextY, this is what to free
+
+typedef struct {
+    Vec2 oldPos, pos;
+    Vec2 vel;
+    float deltaTime;
+    int tests;
+} ActorMove;
+
+static int CellCoord(float v) {
+    return static_cast<int>(floorf(v * (1.0f / ACTOR_CELL_SIZE)));
+}
+
+static int BucketOf(int cx, int cy) {
+    return (static_cast<Uint32>(cx) * 73856093u ^ static_cast<Uint32>(cy) * 19349663u) & actors.bucketMask;
+}
+
+void InitActors(int capacity) {
+    FreeActors();
+
+    int n = capacity > 0 ? capacity : 1;
+    float* floats = actorFloats = static_cast<float*>(malloc(n * 6 * sizeof(float)));
+    actors.x = floats;
+    actors.y = floats + n;
+    actors.velX = floats + n * 2;
+    actors.velY = floats + n * 3;
+    actors.nextX = floats + n * 4;
+    actors.nextY = floats + n * 5;
+    actors.bucket = static_cast<int*>(malloc(n * sizeof(int)));
+    actors.bucketActors = static_cast<int*>(malloc(n * sizeof(int)));
+    actors.capacity = capacity;
+
+    // at least two buckets per actor keeps the cells that share one rare
+    int buckets = 1024;
+    while (buckets < n * 2) buckets *= 2;
+    actors.bucketMask = buckets - 1;
+    actors.bucketStart = static_cast<int*>(malloc((buckets + 1) * sizeof(int)));
+}
+
+void FreeActors() {
+    free(actorFloats);
+    actorFloats = NULL;
+    free(actors.bucket);
+    free(actors.bucketActors);
+    free(actors.bucketStart);
+    for (int t = 0; t < MAX_JOB_THREADS; t++) FreeGridQuery(&actors.queries[t]);
+    memset(&actors, 0, sizeof(actors));
+}
+
+int AddActor(float x, float y, float velX, float velY) {
+    if (actors.count == actors.capacity) return -1;
+    int a = actors.count++;
+    actors.x[a] = x;
+    actors.y[a] = y;
+    actors.velX[a] = velX;
+    actors.velY[a] = velY;
+    return a;
+}
+
+int SpawnActors(int count, Uint32 seed) {
+    if (level.vertexCount == 0) return 0;
+    Vec2 lo = level.boundsMin, hi = level.boundsMax;
+
+    int placed = 0;
+    for (int tries = 0; placed < count && tries < count * 20; tries++) {
+        seed = seed * 1664525 + 1013904223;
+        float fx = (seed >> 8) / 16777216.0f;
+        seed = seed * 1664525 + 1013904223;
+        float fy = (seed >> 8) / 16777216.0f;
+        seed = seed * 1664525 + 1013904223;
+        float angle = (seed >> 8) / 16777216.0f * 2 * M_PI;
+
+        Vec2 pos = { lo.x + (hi.x - lo.x) * fx, lo.y + (hi.y - lo.y) * fy };
+        if (!IsOpenSpot(pos, ACTOR_RADIUS)) continue;
+
+        if (AddActor(pos.x, pos.y, ACTOR_SPEED * cosf(angle), ACTOR_SPEED * sinf(angle)) < 0) break;
+        placed++;
+    }
+    return placed;
+}
+
+// Slides along the wall like the player and turns the velocity away from it, so
+// actors keep walking instead of pressing into the first wall they meet
+static void CollideActorWall(int w, void* userData) {
+    ActorMove* move = static_cast<ActorMove*>(userData);
+
+    LineSeg line;
+    line.p1 = level.verts[level.walls[w].v1];
+    line.p2 = level.verts[level.walls[w].v2];
+
+    move->tests++;
+    if (!LineCircleCollision(line, move->pos, ACTOR_RADIUS)) return;
+
+    Vec2 away = VecMinus(move->pos, ClosestPointOnLine(line, move->pos));
+    move->pos = ResolveCollision(move->oldPos, move->pos, line, move->deltaTime);
+    if (away.x == 0 && away.y == 0) return;
+
+    Vec2 n = Normalize(away);
+    float dot = Dot(move->vel, n);
+    if (dot < 0) move->vel = VecMinus(move->vel, VecMulF(n, 2 * dot));
+}
+
+// Sum of the pushes from every actor overlapping actor a. The cells are twice as
+// wide as the reach, so those are all in the 2x2 cells toward the quarter of its
+// cell a is in. Two of them can hash to the same bucket, which is only read once.
+static Vec2 Separation(int a) {
+    float x = actors.x[a], y = actors.y[a];
+    const float reach = 2 * ACTOR_RADIUS;
+    int cx = CellCoord(x - reach), cy = CellCoord(y - reach);
+
+    int seen[4];
+    int seenCount = 0;
+    Vec2 push = { 0, 0 };
+    for (int j = cy; j <= cy + 1; j++) {
+        for (int i = cx; i <= cx + 1; i++) {
+            int bucket = BucketOf(i, j);
+            int repeat = 0;
+            for (int k = 0; k < seenCount; k++) repeat |= seen[k] == bucket;
+            if (repeat) continue;
+            seen[seenCount++] = bucket;
+
+            for (int k = actors.bucketStart[bucket]; k < actors.bucketStart[bucket + 1]; k++) {
+                int other = actors.bucketActors[k];
+                float dx = x - actors.x[other], dy = y - actors.y[other];
+                float distSq = dx * dx + dy * dy;
+                // on the same spot there is no direction, the walk parts them
+                if (other == a || distSq >= reach * reach || distSq == 0) continue;
+
+                float dist = sqrtf(distSq);
+                float scale = (reach - dist) / dist * ACTOR_SEPARATION * 0.5f;
+                push.x += dx * scale;
+                push.y += dy * scale;
+            }
+        }
+    }
+    return push;
+}
+
+// Job body, reads x, y and the cell list and only writes the chunk's own actors
+static void StepActors(int chunk, void* userData) {
+    PROFILE_SCOPE("actors chunk");
+    float dt = *static_cast<float*>(userData);
+    GridQuery* query = &actors.queries[JobsThreadIndex()];
+    if (!query->wallStamp) InitGridQuery(query);
+
+    int first = chunk * ACTOR_CHUNK;
+    int last = first + ACTOR_CHUNK < actors.count ? first + ACTOR_CHUNK : actors.count;
+    int tests = 0;
+    for (int a = first; a < last; a++) {
+        ActorMove move;
+        move.oldPos.x = actors.x[a];
+        move.oldPos.y = actors.y[a];
+        move.vel.x = actors.velX[a];
+        move.vel.y = actors.velY[a];
+        move.deltaTime = dt;
+        move.tests = 0;
+
+        Vec2 push = Separation(a);
+        move.pos.x = move.oldPos.x + move.vel.x * dt + push.x;
+        move.pos.y = move.oldPos.y + move.vel.y * dt + push.y;
+
+        Vec2 boxMin, boxMax;
+        boxMin.x = fminf(move.oldPos.x, move.pos.x) - ACTOR_RADIUS;
+        boxMin.y = fminf(move.oldPos.y, move.pos.y) - ACTOR_RADIUS;
+        boxMax.x = fmaxf(move.oldPos.x, move.pos.x) + ACTOR_RADIUS;
+        boxMax.y = fmaxf(move.oldPos.y, move.pos.y) + ACTOR_RADIUS;
+        QueryWallGridWith(query, boxMin, boxMax, CollideActorWall, &move);
+        tests += move.tests;
+
+        // a level open to the outside still keeps its actors
+        if (move.pos.x < level.boundsMin.x || move.pos.x > level.boundsMax.x) {
+            move.pos.x = move.oldPos.x;
+            move.vel.x = -move.vel.x;
+        }
+        if (move.pos.y < level.boundsMin.y || move.pos.y > level.boundsMax.y) {
+            move.pos.y = move.oldPos.y;
+            move.vel.y = -move.vel.y;
+        }
+
+        actors.nextX[a] = move.pos.x;
+        actors.nextY[a] = move.pos.y;
+        actors.velX[a] = move.vel.x;
+        actors.velY[a] = move.vel.y;
+    }
+
+    PROFILE_COUNT(COUNTER_COLLISION_TESTS, tests);
+}
+
+static void FindBuckets(int chunk, void* userData) {
+    int first = chunk * ACTOR_CHUNK;
+    int last = first + ACTOR_CHUNK < actors.count ? first + ACTOR_CHUNK : actors.count;
+    for (int a = first; a < last; a++) actors.bucket[a] = BucketOf(CellCoord(actors.x[a]), CellCoord(actors.y[a]));
+}
+
+// Counting sort of the actors by bucket, the buckets themselves are found in parallel
+static void BuildCellList(int chunks) {
+    JobsRun(chunks, FindBuckets, NULL);
+
+    int buckets = actors.bucketMask + 1;
+    memset(actors.bucketStart, 0, (buckets + 1) * sizeof(int));
+    for (int a = 0; a < actors.count; a++) actors.bucketStart[actors.bucket[a]]++;
+    for (int b = 1; b <= buckets; b++) actors.bucketStart[b] += actors.bucketStart[b - 1];
+
+    // every bucket starts out at its end and fills back to front, which leaves
+    // bucketStart at the start of every bucket and each bucket in actor order
+    for (int a = actors.count - 1; a >= 0; a--) actors.bucketActors[--actors.bucketStart[actors.bucket[a]]] = a;
+}
+
+void ActorsTick(float dt) {
+    PROFILE_SCOPE("actors");
+    if (actors.count == 0) return;
+
+    int chunks = (actors.count + ACTOR_CHUNK - 1) / ACTOR_CHUNK;
+    BuildCellList(chunks);
+    JobsRun(chunks, StepActors, &dt);
+
+    float* t = actors.x; actors.x = actors.nextX; actors.nextX = t;
+    t = actors.y; actors.y = actors.nextY; actors.nextY = t;
+    actors.ticks++;
+}
+
+Uint64 HashActors() {
+    Uint64 hash = 1469598103934665603ull;
+    for (int a = 0; a < actors.count; a++) {
+        Uint32 bits[2];
+        memcpy(&bits[0], &actors.x[a], sizeof(Uint32));
+        memcpy(&bits[1], &actors.y[a], sizeof(Uint32));
+        hash = (hash ^ bits[0]) * 1099511628211ull;
+        hash = (hash ^ bits[1]) * 1099511628211ull;
+    }
+    return hash;
+}
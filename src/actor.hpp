@@ -0,0 +1,58 @@
+#pragma once
+
+#include "grid.hpp"
+#include "jobs.hpp"
+#include "typedefs.hpp"
+
+// Moving actors, bots and monsters, that walk the level and slide along its walls
+// with the same circle against wall collision as the player. Every field is its
+// own array. A tick reads the positions of the previous one and writes the next
+// ones, so the actors are stepped in parallel chunks without locks and the result
+// does not depend on the thread count. Actors keep apart by pushing off the ones
+// they overlap, found through a cell list rebuilt every tick. The cells are
+// hashed into a table sized for the actor count, so the list costs the same on
+// any size of level.
+
+#define ACTOR_RADIUS 8.0f
+#define ACTOR_SPEED 60.0f       // world units per second
+#define ACTOR_SEPARATION 0.5f   // share of an overlap pushed away per tick
+#define ACTOR_CHUNK 512         // actors per job
+#define ACTOR_CELL_SIZE (4 * ACTOR_RADIUS)
+
+typedef struct {
+    float* x;
+    float* y;
+    float* velX;
+    float* velY;
+    float* nextX; // written by the tick, then swapped with x and y
+    float* nextY;
+    int* bucket;  // where the cell of x and y hashes to
+    int count, capacity;
+
+    // cell list, actors grouped by bucket, cells that hash alike share one
+    int bucketMask;
+    int* bucketStart; // bucketMask + 2 offsets into bucketActors
+    int* bucketActors;
+
+    GridQuery queries[MAX_JOB_THREADS]; // wall queries of each job thread
+    Uint64 ticks;
+} ActorPool;
+
+extern ActorPool actors;
+
+// Sizes the pool for capacity actors over the loaded level. Needs the wall grid.
+void InitActors(int capacity);
+void FreeActors();
+
+// Returns the new actor or -1 when the pool is full
+int AddActor(float x, float y, float velX, float velY);
+
+// Puts up to count actors on random open spots, walking in random directions.
+// Returns how many were placed.
+int SpawnActors(int count, Uint32 seed);
+
+// Moves every actor by dt seconds, across the job pool
+void ActorsTick(float dt);
+
+// Hash of every position, the same for the same ticks on any thread count
+Uint64 HashActors();
@@ -0,0 +1,83 @@
+#include "arena.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ArenaBlock* NewBlock(Arena* arena, size_t size, ArenaBlock* prev) {
+    ArenaBlock* block = static_cast<ArenaBlock*>(malloc(sizeof(ArenaBlock) + size + ARENA_ALIGN));
+    uintptr_t data = reinterpret_cast<uintptr_t>(block + 1);
+    block->data = reinterpret_cast<unsigned char*>((data + ARENA_ALIGN - 1) & ~static_cast<uintptr_t>(ARENA_ALIGN - 1));
+    block->size = size;
+    block->prev = prev;
+    arena->heapAllocs++;
+    return block;
+}
+
+static void FreeBlocks(ArenaBlock* block) {
+    while (block) {
+        ArenaBlock* prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
+void ArenaInit(Arena* arena, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->block = NewBlock(arena, size > 0 ? size : ARENA_ALIGN, NULL);
+}
+
+void ArenaFree(Arena* arena) {
+    FreeBlocks(arena->block);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void ArenaReset(Arena* arena) {
+    size_t used = ArenaUsed(arena);
+    if (used > arena->highWater) arena->highWater = used;
+
+    // a frame that spilled into several blocks gets one block that fits it next time
+    if (arena->block->prev) {
+        size_t size = 0;
+        for (ArenaBlock* b = arena->block; b; b = b->prev) size += b->size;
+        FreeBlocks(arena->block);
+        arena->block = NewBlock(arena, size, NULL);
+    }
+
+    arena->offset = 0;
+    arena->usedBefore = 0;
+}
+
+void* ArenaAlloc(Arena* arena, size_t bytes, size_t align) {
+    size_t start = (arena->offset + align - 1) & ~(align - 1);
+
+    if (start + bytes > arena->block->size) {
+        size_t size = arena->block->size * 2;
+        if (size < bytes) size = bytes;
+        arena->usedBefore += arena->offset;
+        arena->block = NewBlock(arena, size, arena->block);
+        start = 0;
+    }
+
+    arena->offset = start + bytes;
+    return arena->block->data + start;
+}
+
+void* ArenaGrow(Arena* arena, void* ptr, size_t oldBytes, size_t newBytes, size_t align) {
+    unsigned char* bytes = static_cast<unsigned char*>(ptr);
+    if (ptr && bytes + oldBytes == arena->block->data + arena->offset) {
+        size_t start = bytes - arena->block->data;
+        if (start + newBytes <= arena->block->size) {
+            arena->offset = start + newBytes;
+            return ptr;
+        }
+    }
+
+    void* grown = ArenaAlloc(arena, newBytes, align);
+    if (ptr) memcpy(grown, ptr, oldBytes < newBytes ? oldBytes : newBytes);
+    return grown;
+}
+
+size_t ArenaUsed(const Arena* arena) {
+    return arena->usedBefore + arena->offset;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+
+// Linear allocator for data that only lives until the end of a frame. Allocation
+// bumps an offset and ArenaReset() frees everything at once. When a frame needs
+// more than the current block a new one is chained on, and the next reset folds
+// them into one block big enough for the high water mark, so after the first
+// few frames nothing is taken from the heap any more. Not thread safe, only the
+// main thread allocates and workers just use the memory.
+
+#define ARENA_ALIGN 64 // blocks start on a cache line
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* prev; // older block still in use this frame
+    size_t size;
+    unsigned char* data;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* block;
+    size_t offset;     // used bytes of the newest block
+    size_t usedBefore; // used bytes of the older blocks
+    size_t highWater;  // most bytes ever used in one frame
+    int heapAllocs;    // blocks taken from the heap since ArenaInit
+} Arena;
+
+void ArenaInit(Arena* arena, size_t size);
+void ArenaFree(Arena* arena);
+void ArenaReset(Arena* arena);
+
+void* ArenaAlloc(Arena* arena, size_t bytes, size_t align);
+
+// Resizes the latest allocation in place when nothing was allocated after it,
+// otherwise copies it to a new allocation
+void* ArenaGrow(Arena* arena, void* ptr, size_t oldBytes, size_t newBytes, size_t align);
+
+size_t ArenaUsed(const Arena* arena);
+
+#define ARENA_NEW(arena, type, count) static_cast<type*>(ArenaAlloc(arena, (count) * sizeof(type), alignof(type)))
@@ -0,0 +1,329 @@
+#include "assets.hpp"
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+AssetStats assetStats;
+
+typedef enum {
+    ASSET_LOADING,
+    ASSET_READY,
+    ASSET_FAILED,
+    ASSET_EVICTED
+} AssetState;
+
+typedef struct {
+    char* fileName;
+    AssetState state;
+    int waiting;       // loading but not in the request queue yet, it was full
+    Texture texture;
+    size_t blockBytes;
+    int prev, next;    // least recently used list, the most recent at the head
+} AssetEntry;
+
+typedef struct {
+    int entry;
+    int ok;
+    Texture texture;
+    size_t blockBytes;
+    double decodeMs;
+} AssetResult;
+
+// Single producer single consumer ring, only the producer moves tail and only
+// the consumer moves head
+template <typename T>
+struct AssetRing {
+    T items[ASSET_QUEUE_SIZE];
+    std::atomic<Uint32> head, tail;
+};
+
+template <typename T>
+static int RingPush(AssetRing<T>* ring, const T& item) {
+    Uint32 tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) == ASSET_QUEUE_SIZE) return 0;
+    ring->items[tail & (ASSET_QUEUE_SIZE - 1)] = item;
+    ring->tail.store(tail + 1, std::memory_order_release);
+    return 1;
+}
+
+template <typename T>
+static int RingPop(AssetRing<T>* ring, T* item) {
+    Uint32 head = ring->head.load(std::memory_order_relaxed);
+    if (head == ring->tail.load(std::memory_order_acquire)) return 0;
+    *item = ring->items[head & (ASSET_QUEUE_SIZE - 1)];
+    ring->head.store(head + 1, std::memory_order_release);
+    return 1;
+}
+
+template <typename T>
+static int RingEmpty(AssetRing<T>* ring) {
+    return ring->head.load(std::memory_order_acquire) == ring->tail.load(std::memory_order_acquire);
+}
+
+static AssetEntry entries[ASSET_MAX];
+static int entryCount;
+static int lruHead = -1, lruTail = -1;
+static int loading; // entries waiting, queued or being decoded
+static size_t budget;
+static Uint64 initCounter;
+
+static AssetRing<int> requests;
+static AssetRing<AssetResult> results;
+static std::thread loader;
+static std::mutex wakeLock;
+static std::condition_variable wakeLoader;
+static std::atomic<int> quitting(0);
+
+// Free blocks by size class, linked through their first bytes. The loader takes
+// blocks and the main thread gives them back, so unlike the rest this is locked.
+static std::mutex poolLock;
+static void* freeBlocks[ASSET_BLOCK_CLASSES];
+static size_t pooledBytes;
+
+static int BlockClass(size_t bytes) {
+    int c = 0;
+    while (c < ASSET_BLOCK_CLASSES - 1 && (static_cast<size_t>(1) << (c + ASSET_MIN_BLOCK_SHIFT)) < bytes) c++;
+    return c;
+}
+
+static Uint8* PoolAlloc(size_t bytes, void* userData) {
+    int c = BlockClass(bytes);
+    size_t size = static_cast<size_t>(1) << (c + ASSET_MIN_BLOCK_SHIFT);
+    *static_cast<size_t*>(userData) = size;
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        void* block = freeBlocks[c];
+        if (block) {
+            memcpy(&freeBlocks[c], block, sizeof(void*));
+            pooledBytes -= size;
+            return static_cast<Uint8*>(block);
+        }
+    }
+    return static_cast<Uint8*>(malloc(size));
+}
+
+static void PoolFree(void* block, size_t size) {
+    std::lock_guard<std::mutex> guard(poolLock);
+    int c = BlockClass(size);
+    memcpy(block, &freeBlocks[c], sizeof(void*));
+    freeBlocks[c] = block;
+    pooledBytes += size;
+}
+
+// Hands free blocks back to the heap, biggest first, until at most limit bytes stay pooled
+static void TrimPool(size_t limit) {
+    std::lock_guard<std::mutex> guard(poolLock);
+    for (int c = ASSET_BLOCK_CLASSES - 1; c >= 0 && pooledBytes > limit; c--) {
+        size_t size = static_cast<size_t>(1) << (c + ASSET_MIN_BLOCK_SHIFT);
+        while (freeBlocks[c] && pooledBytes > limit) {
+            void* block = freeBlocks[c];
+            memcpy(&freeBlocks[c], block, sizeof(void*));
+            free(block);
+            pooledBytes -= size;
+        }
+    }
+    assetStats.bytesPooled = pooledBytes;
+}
+
+static void LoaderLoop() {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    for (;;) {
+        int entry;
+        if (!RingPop(&requests, &entry)) {
+            std::unique_lock<std::mutex> guard(wakeLock);
+            wakeLoader.wait(guard, [] { return quitting.load() || !RingEmpty(&requests); });
+            if (quitting.load()) return;
+            continue;
+        }
+
+        AssetResult result;
+        result.entry = entry;
+        result.blockBytes = 0;
+        Uint64 start = SDL_GetPerformanceCounter();
+        result.ok = DecodeTexture(entries[entry].fileName, &result.texture, PoolAlloc, &result.blockBytes);
+        result.decodeMs = (SDL_GetPerformanceCounter() - start) * toMs;
+
+        // the main thread drains results every frame, a full queue only means a slow frame
+        while (!RingPush(&results, result)) {
+            if (quitting.load()) {
+                if (result.ok) PoolFree(result.texture.data, result.blockBytes);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+static void WakeLoader() {
+    // taking the lock orders the push before the loader's check of the queue
+    { std::lock_guard<std::mutex> guard(wakeLock); }
+    wakeLoader.notify_one();
+}
+
+static void LruRemove(int e) {
+    AssetEntry* entry = &entries[e];
+    if (entry->prev >= 0) entries[entry->prev].next = entry->next;
+    else lruHead = entry->next;
+    if (entry->next >= 0) entries[entry->next].prev = entry->prev;
+    else lruTail = entry->prev;
+    entry->prev = entry->next = -1;
+}
+
+static void LruPushFront(int e) {
+    AssetEntry* entry = &entries[e];
+    entry->prev = -1;
+    entry->next = lruHead;
+    if (lruHead >= 0) entries[lruHead].prev = e;
+    lruHead = e;
+    if (lruTail < 0) lruTail = e;
+}
+
+static void StartLoad(int e) {
+    entries[e].state = ASSET_LOADING;
+    entries[e].waiting = !RingPush(&requests, e);
+    if (!entries[e].waiting) WakeLoader();
+    loading++;
+    assetStats.readyMs = 0;
+}
+
+void InitAssets(size_t bytes) {
+    ShutdownAssets();
+    memset(&assetStats, 0, sizeof(assetStats));
+    budget = bytes;
+    initCounter = SDL_GetPerformanceCounter();
+    quitting = 0;
+    loader = std::thread(LoaderLoop);
+
+    // a waiting loader would block the exit in the condition variable's destructor,
+    // so an early return after Init() still stops it first
+    static int atExitSet = 0;
+    if (!atExitSet) atexit(ShutdownAssets);
+    atExitSet = 1;
+}
+
+void ShutdownAssets() {
+    if (loader.joinable()) {
+        quitting = 1;
+        WakeLoader();
+        loader.join();
+    }
+
+    AssetResult result;
+    while (RingPop(&results, &result)) {
+        if (result.ok) PoolFree(result.texture.data, result.blockBytes);
+    }
+    int request;
+    while (RingPop(&requests, &request)) {}
+
+    for (int e = 0; e < entryCount; e++) {
+        if (entries[e].state == ASSET_READY) PoolFree(entries[e].texture.data, entries[e].blockBytes);
+        free(entries[e].fileName);
+    }
+    memset(entries, 0, sizeof(entries));
+    entryCount = 0;
+    lruHead = lruTail = -1;
+    loading = 0;
+    TrimPool(0);
+}
+
+void SetAssetBudget(size_t bytes) {
+    budget = bytes;
+}
+
+int RequestTexture(const char* fileName) {
+    for (int e = 0; e < entryCount; e++) {
+        if (strcmp(entries[e].fileName, fileName) == 0) return e;
+    }
+    if (entryCount == ASSET_MAX) return -1;
+
+    int e = entryCount++;
+    memset(&entries[e], 0, sizeof(entries[e]));
+    entries[e].fileName = strdup(fileName);
+    entries[e].prev = entries[e].next = -1;
+    StartLoad(e);
+    return e;
+}
+
+const Texture* AcquireTexture(int handle, const Texture* placeholder) {
+    if (handle < 0 || handle >= entryCount) return placeholder;
+
+    AssetEntry* entry = &entries[handle];
+    if (entry->state == ASSET_READY) {
+        assetStats.hits++;
+        if (lruHead != handle) {
+            LruRemove(handle);
+            LruPushFront(handle);
+        }
+        return &entry->texture;
+    }
+    if (entry->state == ASSET_FAILED) return placeholder;
+
+    assetStats.misses++;
+    if (entry->state == ASSET_EVICTED) StartLoad(handle);
+    return placeholder;
+}
+
+// Runs between frames, so no raster job still reads a texture this frees. The most
+// recent texture stays even over the budget, or one bigger than all of it would
+// be loaded and thrown away forever.
+static void EvictToBudget() {
+    while (assetStats.bytesUsed > budget && lruTail != lruHead) {
+        int e = lruTail;
+        LruRemove(e);
+        PoolFree(entries[e].texture.data, entries[e].blockBytes);
+        memset(&entries[e].texture, 0, sizeof(Texture));
+        entries[e].state = ASSET_EVICTED;
+        assetStats.bytesUsed -= entries[e].blockBytes;
+        assetStats.evictions++;
+    }
+}
+
+void PumpAssets() {
+    for (int e = 0; e < entryCount; e++) {
+        if (entries[e].waiting && RingPush(&requests, e)) {
+            entries[e].waiting = 0;
+            WakeLoader();
+        }
+    }
+
+    AssetResult result;
+    while (RingPop(&results, &result)) {
+        AssetEntry* entry = &entries[result.entry];
+        assetStats.loads++;
+        assetStats.decodeMs += result.decodeMs;
+        loading--;
+        if (!result.ok) {
+            entry->state = ASSET_FAILED;
+            assetStats.failures++;
+            continue;
+        }
+
+        entry->state = ASSET_READY;
+        entry->texture = result.texture;
+        entry->blockBytes = result.blockBytes;
+        LruPushFront(result.entry);
+        assetStats.bytesUsed += result.blockBytes;
+        if (assetStats.bytesUsed > assetStats.bytesPeak) assetStats.bytesPeak = assetStats.bytesUsed;
+    }
+
+    EvictToBudget();
+    TrimPool(budget > assetStats.bytesUsed ? budget - assetStats.bytesUsed : 0);
+
+    if (loading == 0 && assetStats.readyMs == 0) {
+        assetStats.readyMs = static_cast<double>(SDL_GetPerformanceCounter() - initCounter) * 1000.0 / SDL_GetPerformanceFrequency();
+    }
+}
+
+void WaitForAssets() {
+    PumpAssets();
+    while (loading > 0) {
+        SDL_Delay(1);
+        PumpAssets();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "texture.hpp"
+#include "typedefs.hpp"
+
+#include <stddef.h>
+
+// Textures decoded on a background thread so image files never stall a frame.
+// Asking for a texture queues its file and hands back a placeholder until the
+// data arrives. The loader decodes with stb_image, builds the mips into a block
+// from the cache pool and passes the result back through a lock-free queue that
+// the main thread drains once per frame. The cache keeps textures under a memory
+// budget, evicting the least recently drawn ones between frames, never during one.
+// A texture that was evicted is loaded again the next time it is asked for.
+//
+// Everything but the loader itself runs on the main thread.
+
+#define ASSET_MAX 256
+#define ASSET_QUEUE_SIZE 64                      // requests or results in flight, a power of two
+#define ASSET_DEFAULT_BUDGET (64u * 1024 * 1024) // bytes of texture blocks
+#define ASSET_MIN_BLOCK_SHIFT 12                 // pool blocks are powers of two from 4 KB up
+#define ASSET_BLOCK_CLASSES 10                   // up to 2 MB, a full chain of TEXTURE_MAX_SIZE
+
+typedef struct {
+    Uint64 hits;      // textures asked for that were there
+    Uint64 misses;    // asked for while loading, or again after an eviction
+    Uint64 evictions;
+    Uint64 loads;     // finished decodes, failed ones included
+    Uint64 failures;
+    size_t bytesUsed; // held by textures in the cache
+    size_t bytesPeak;
+    size_t bytesPooled; // free blocks kept for the next texture of their size
+    double decodeMs;    // loader thread time, summed
+    double readyMs;     // from InitAssets() until nothing was loading, 0 while something is
+} AssetStats;
+
+extern AssetStats assetStats;
+
+// Starts the loader thread. Needs the palette.
+void InitAssets(size_t budget);
+void ShutdownAssets();
+void SetAssetBudget(size_t budget);
+
+// Returns a handle for the texture in fileName and starts loading it unless the
+// cache already has it. Asking again for the same file gives the same handle.
+// Returns -1 when the cache has no room for another file.
+int RequestTexture(const char* fileName);
+
+// The texture when it is loaded, placeholder otherwise or when the file failed.
+// Counts a hit or a miss and makes the texture the most recently used.
+const Texture* AcquireTexture(int handle, const Texture* placeholder);
+
+// Once per frame on the main thread, before drawing: takes in finished textures
+// and evicts until the cache fits the budget again
+void PumpAssets();
+
+// Pumps until nothing is loading, for runs that must draw every frame the same way
+void WaitForAssets();
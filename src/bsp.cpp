@@ -0,0 +1,297 @@
+#include "bsp.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+#include "transform.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define BSP_EPSILON 0.001 // distance from a partition line that still counts as on it
+#define BSP_NEAR_CLIP 0.1f
+
+BspTree bsp;
+
+static Uint32* traversalStack;
+
+typedef struct {
+    int v1, v2;
+    int wall, poly;
+    float offset;
+} BuildSeg;
+
+typedef struct {
+    std::vector<Vec2> verts;
+    std::vector<BuildSeg> segs; // every seg ever made, lists below index into it
+    std::vector<BspSeg> leafSegs;
+    std::vector<BspNode> nodes;
+    std::vector<BspLeaf> leaves;
+    int maxDepth;
+} BspBuilder;
+
+enum { SIDE_FRONT, SIDE_BACK, SIDE_SPLIT };
+
+// Negative is the front (right) side of the line
+static double LineSide(Vec2 origin, Vec2 dir, double dirLen, Vec2 p) {
+    return (static_cast<double>(dir.x) * (p.y - origin.y) - static_cast<double>(dir.y) * (p.x - origin.x)) / dirLen;
+}
+
+static int ClassifySeg(const BspBuilder* b, const BuildSeg* splitter, const BuildSeg* seg, double* sa, double* sb) {
+    Vec2 origin = b->verts[splitter->v1];
+    Vec2 dir = VecMinus(b->verts[splitter->v2], origin);
+    double dirLen = sqrt(static_cast<double>(dir.x) * dir.x + static_cast<double>(dir.y) * dir.y);
+
+    *sa = LineSide(origin, dir, dirLen, b->verts[seg->v1]);
+    *sb = LineSide(origin, dir, dirLen, b->verts[seg->v2]);
+
+    if (fabs(*sa) < BSP_EPSILON && fabs(*sb) < BSP_EPSILON) {
+        // on the partition line, segs facing the same way share its front
+        Vec2 segDir = VecMinus(b->verts[seg->v2], b->verts[seg->v1]);
+        return Dot(segDir, dir) > 0 ? SIDE_FRONT : SIDE_BACK;
+    }
+    if (*sa < BSP_EPSILON && *sb < BSP_EPSILON) return SIDE_FRONT;
+    if (*sa > -BSP_EPSILON && *sb > -BSP_EPSILON) return SIDE_BACK;
+    return SIDE_SPLIT;
+}
+
+// Score is -1 for a splitter that would leave the back side empty
+static int ScoreSplitter(const BspBuilder* b, const std::vector<int>& list, int splitter) {
+    int front = 0, back = 0, splits = 0;
+    double sa, sb;
+
+    for (int segIdx : list) {
+        switch (ClassifySeg(b, &b->segs[splitter], &b->segs[segIdx], &sa, &sb)) {
+            case SIDE_FRONT: front++; break;
+            case SIDE_BACK: back++; break;
+            default: splits++; break;
+        }
+    }
+
+    if (back == 0 && splits == 0) return -1;
+    return splits * BSP_SPLIT_COST + abs(front - back);
+}
+
+// Picks the best of a few evenly spread candidates. Only when none of them
+// separates anything is every seg tried, which proves the set is convex.
+static int ChooseSplitter(const BspBuilder* b, const std::vector<int>& list) {
+    int count = list.size();
+    int step = count > BSP_CANDIDATES ? count / BSP_CANDIDATES : 1;
+    int best = -1, bestScore = 0;
+
+    for (int i = 0; i < count; i += step) {
+        int score = ScoreSplitter(b, list, list[i]);
+        if (score >= 0 && (best < 0 || score < bestScore)) {
+            best = list[i];
+            bestScore = score;
+        }
+    }
+    if (best >= 0 || step == 1) return best;
+
+    for (int i = 0; i < count; i++) {
+        if (ScoreSplitter(b, list, list[i]) >= 0) return list[i];
+    }
+    return -1;
+}
+
+static void GrowBBox(float* box, Vec2 p) {
+    if (p.x < box[0]) box[0] = p.x;
+    if (p.y < box[1]) box[1] = p.y;
+    if (p.x > box[2]) box[2] = p.x;
+    if (p.y > box[3]) box[3] = p.y;
+}
+
+static void ListBBox(const BspBuilder* b, const std::vector<int>& list, float* box) {
+    box[0] = box[1] = 1e30f;
+    box[2] = box[3] = -1e30f;
+    for (int segIdx : list) {
+        GrowBBox(box, b->verts[b->segs[segIdx].v1]);
+        GrowBBox(box, b->verts[b->segs[segIdx].v2]);
+    }
+}
+
+static Uint32 MakeLeaf(BspBuilder* b, const std::vector<int>& list) {
+    BspLeaf leaf;
+    leaf.firstSeg = b->leafSegs.size();
+    leaf.segCount = list.size();
+
+    for (int segIdx : list) {
+        const BuildSeg* s = &b->segs[segIdx];
+        BspSeg seg;
+        seg.v1 = s->v1;
+        seg.v2 = s->v2;
+        seg.wall = s->wall;
+        seg.poly = s->poly;
+        seg.offset = s->offset;
+        b->leafSegs.push_back(seg);
+    }
+
+    b->leaves.push_back(leaf);
+    return (b->leaves.size() - 1) | BSP_LEAF_FLAG;
+}
+
+static Uint32 BuildNode(BspBuilder* b, std::vector<int>& list, int depth) {
+    if (depth > b->maxDepth) b->maxDepth = depth;
+
+    int splitter = ChooseSplitter(b, list);
+    if (splitter < 0) return MakeLeaf(b, list);
+
+    std::vector<int> front, back;
+    BuildSeg split = b->segs[splitter];
+
+    for (int segIdx : list) {
+        double sa, sb;
+        int side = ClassifySeg(b, &split, &b->segs[segIdx], &sa, &sb);
+
+        if (side == SIDE_FRONT) {
+            front.push_back(segIdx);
+        } else if (side == SIDE_BACK) {
+            back.push_back(segIdx);
+        } else {
+            BuildSeg seg = b->segs[segIdx];
+            Vec2 a = b->verts[seg.v1], c = b->verts[seg.v2];
+            float t = static_cast<float>(sa / (sa - sb));
+
+            Vec2 p;
+            p.x = a.x + (c.x - a.x) * t;
+            p.y = a.y + (c.y - a.y) * t;
+            b->verts.push_back(p);
+            int mid = b->verts.size() - 1;
+
+            BuildSeg first = seg, second = seg;
+            first.v2 = mid;
+            second.v1 = mid;
+            second.offset = seg.offset + Len(a, p);
+
+            b->segs.push_back(first);
+            (sa < 0 ? front : back).push_back(b->segs.size() - 1);
+            b->segs.push_back(second);
+            (sb < 0 ? front : back).push_back(b->segs.size() - 1);
+        }
+    }
+
+    BspNode node;
+    node.origin = b->verts[split.v1];
+    node.dir = VecMinus(b->verts[split.v2], node.origin);
+    ListBBox(b, front, node.bbox[0]);
+    ListBBox(b, back, node.bbox[1]);
+
+    int nodeIdx = b->nodes.size();
+    b->nodes.push_back(node);
+
+    std::vector<int>().swap(list);
+    Uint32 frontChild = BuildNode(b, front, depth + 1);
+    Uint32 backChild = BuildNode(b, back, depth + 1);
+    b->nodes[nodeIdx].children[0] = frontChild;
+    b->nodes[nodeIdx].children[1] = backChild;
+
+    return nodeIdx;
+}
+
+template <typename T>
+static T* CopyOut(const std::vector<T>& v) {
+    T* out = static_cast<T*>(malloc((v.empty() ? 1 : v.size()) * sizeof(T)));
+    if (!v.empty()) memcpy(out, v.data(), v.size() * sizeof(T));
+    return out;
+}
+
+int BuildBsp() {
+    FreeBsp();
+
+    BspBuilder b;
+    b.maxDepth = 0;
+    b.verts.assign(level.verts, level.verts + level.vertexCount);
+
+    std::vector<int> all;
+    for (int w = 0; w < level.wallCount; w++) {
+        const LevelWall* wall = &level.walls[w];
+        if (Len(level.verts[wall->v1], level.verts[wall->v2]) < BSP_EPSILON) continue;
+
+        BuildSeg seg;
+        seg.v1 = wall->v1;
+        seg.v2 = wall->v2;
+        seg.wall = w;
+        seg.poly = wall->poly;
+        seg.offset = 0;
+        b.segs.push_back(seg);
+        all.push_back(b.segs.size() - 1);
+    }
+
+    if (all.empty()) return 0;
+    bsp.root = BuildNode(&b, all, 0);
+
+    bsp.verts = CopyOut(b.verts);
+    bsp.vertCount = b.verts.size();
+    bsp.segs = CopyOut(b.leafSegs);
+    bsp.segCount = b.leafSegs.size();
+    bsp.nodes = CopyOut(b.nodes);
+    bsp.nodeCount = b.nodes.size();
+    bsp.leaves = CopyOut(b.leaves);
+    bsp.leafCount = b.leaves.size();
+
+    // the traversal stack holds at most one pending far child per level
+    traversalStack = static_cast<Uint32*>(malloc((b.maxDepth + 2) * sizeof(Uint32)));
+    return 1;
+}
+
+void FreeBsp() {
+    free(bsp.verts);
+    free(bsp.segs);
+    free(bsp.nodes);
+    free(bsp.leaves);
+    free(traversalStack);
+    traversalStack = NULL;
+    memset(&bsp, 0, sizeof(bsp));
+}
+
+// Half plane tests against the near plane and the two 90 degree side planes
+static int BBoxInView(const float* box, Vec2 pos, float cosA, float sinA) {
+    if (pos.x >= box[0] && pos.x <= box[2] && pos.y >= box[1] && pos.y <= box[3]) return 1;
+
+    int behind = 0, right = 0, left = 0;
+    for (int c = 0; c < 4; c++) {
+        float dx = box[(c & 1) ? 2 : 0] - pos.x;
+        float dy = box[(c & 2) ? 3 : 1] - pos.y;
+        float z = dx * cosA + dy * sinA;
+        float side = dx * sinA - dy * cosA;
+
+        behind += z <= BSP_NEAR_CLIP;
+        right += side > z;
+        left += side < -z;
+    }
+
+    return behind < 4 && right < 4 && left < 4;
+}
+
+void TraverseBsp(const Camera* camera, BspLeafFunc visit, void* userData) {
+    if (bsp.nodeCount == 0 && bsp.leafCount == 0) return;
+
+    Vec2 pos = camera->camPos;
+    float cosA, sinA;
+    CameraSinCos(camera, &cosA, &sinA);
+    int top = 0, nodesVisited = 0;
+
+    traversalStack[top++] = bsp.root;
+    while (top > 0) {
+        Uint32 ref = traversalStack[--top];
+
+        // walk down the near side, leaving the far side of every node on the stack
+        while (!(ref & BSP_LEAF_FLAG)) {
+            const BspNode* node = &bsp.nodes[ref];
+            int near = Cross2dPoints(node->dir.x, node->dir.y, pos.x - node->origin.x, pos.y - node->origin.y) > 0;
+            nodesVisited++;
+
+            if (BBoxInView(node->bbox[near ^ 1], pos, cosA, sinA)) traversalStack[top++] = node->children[near ^ 1];
+            if (!BBoxInView(node->bbox[near], pos, cosA, sinA)) {
+                ref = 0;
+                break;
+            }
+            ref = node->children[near];
+        }
+
+        if (!(ref & BSP_LEAF_FLAG)) continue;
+        if (!visit(&bsp.leaves[ref & ~BSP_LEAF_FLAG], userData)) break;
+    }
+
+    PROFILE_COUNT(COUNTER_BSP_NODES, nodesVisited);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// BSP tree over the level walls, built once at load. Walls that straddle a
+// partition line are split into segs, so walking the tree from the camera
+// gives every seg in strict front to back order without any sorting.
+
+#define BSP_LEAF_FLAG 0x80000000 // child index refers to a leaf, not a node
+#define BSP_SPLIT_COST 8         // how many segs of imbalance one split is worth
+#define BSP_CANDIDATES 16        // splitters scored per node
+
+typedef struct {
+    int v1, v2;   // indices into BspTree.verts
+    int wall;     // level wall the seg was cut from
+    int poly;
+    float offset; // distance of v1 from the start of the wall
+} BspSeg;
+
+typedef struct {
+    Vec2 origin, dir;    // partition line, the front side is on the right of dir
+    Uint32 children[2];  // front, back
+    float bbox[2][4];    // per child: min x, min y, max x, max y
+} BspNode;
+
+typedef struct {
+    int firstSeg, segCount;
+} BspLeaf;
+
+typedef struct {
+    Vec2* verts; // level vertices followed by the ones made by splits
+    int vertCount;
+    BspSeg* segs;
+    int segCount;
+    BspNode* nodes;
+    int nodeCount;
+    BspLeaf* leaves;
+    int leafCount;
+    Uint32 root;
+} BspTree;
+
+extern BspTree bsp;
+
+// Returns 0 to stop the traversal
+typedef int (*BspLeafFunc)(const BspLeaf* leaf, void* userData);
+
+int BuildBsp();
+void FreeBsp();
+
+// Visits the leaves in front of the camera nearest first, subtrees whose
+// bounding box is outside the view frustum are skipped
+void TraverseBsp(const Camera* camera, BspLeafFunc visit, void* userData);
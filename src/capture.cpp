@@ -0,0 +1,280 @@
+#include "capture.hpp"
+#include "cpu.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+CaptureStats captureStats;
+
+typedef struct {
+    Uint32* pixels; // screenW x screenH of them when it was copied, packed
+    int width, height;
+} CaptureSlot;
+
+// Single producer single consumer: CaptureFrame() only moves tail, the writer only head
+static CaptureSlot slots[CAPTURE_SLOTS];
+static Uint32* slotMemory;
+static std::atomic<Uint32> slotHead(0), slotTail(0);
+
+static int capturing;
+static FILE* file;
+static int videoW, videoH;
+static YuvFunc yuv;
+
+// Writer thread only
+static Uint32* scaled;  // a frame at the video size
+static int* sourceColumn;
+static Uint8* planes;   // Y, U and V of one frame
+
+static std::thread writer;
+static std::mutex wakeLock;
+static std::condition_variable wakeWriter;
+static std::atomic<int> stopping(0);
+
+static inline Uint8 ClampByte(int v) {
+    return static_cast<Uint8>(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+static inline Uint8 Luma(Uint32 c) {
+    int r = (c >> 16) & 0xFF, g = (c >> 8) & 0xFF, b = c & 0xFF;
+    return static_cast<Uint8>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+static void RowsToYuvScalar(const Uint32* row0, const Uint32* row1, int width, Uint8* y0, Uint8* y1, Uint8* u, Uint8* v) {
+    for (int x = 0; x < width; x += 2) {
+        Uint32 block[4] = { row0[x], row0[x + 1], row1[x], row1[x + 1] };
+        int r = 0, g = 0, b = 0;
+        for (int i = 0; i < 4; i++) {
+            r += (block[i] >> 16) & 0xFF;
+            g += (block[i] >> 8) & 0xFF;
+            b += block[i] & 0xFF;
+        }
+
+        y0[x] = Luma(block[0]);
+        y0[x + 1] = Luma(block[1]);
+        y1[x] = Luma(block[2]);
+        y1[x + 1] = Luma(block[3]);
+        // the sums are four times the average, so the shift is two bits longer
+        u[x / 2] = ClampByte(((-43 * r - 85 * g + 128 * b + 512) >> 10) + 128);
+        v[x / 2] = ClampByte(((128 * r - 107 * g - 21 * b + 512) >> 10) + 128);
+    }
+}
+
+#ifdef DOOM_X86
+
+// Channels of 16 pixels as 16 bit lanes. Packing works per 128 bit lane, the
+// permute puts the pixels back in order.
+TARGET_AVX2 static inline void SplitChannels(const Uint32* pixels, __m256i* r, __m256i* g, __m256i* b) {
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + 8));
+    *r = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 16), mask), _mm256_and_si256(_mm256_srli_epi32(hi, 16), mask)), 0xD8);
+    *g = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(_mm256_srli_epi32(lo, 8), mask), _mm256_and_si256(_mm256_srli_epi32(hi, 8), mask)), 0xD8);
+    *b = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(lo, mask), _mm256_and_si256(hi, mask)), 0xD8);
+}
+
+// The weighted sum tops out at 65408, so it fits 16 bit lanes read as unsigned
+TARGET_AVX2 static inline void StoreLuma(Uint8* dst, __m256i r, __m256i g, __m256i b) {
+    __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(77)), _mm256_mullo_epi16(g, _mm256_set1_epi16(150))),
+                                   _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(29)), _mm256_set1_epi16(128)));
+    __m256i luma = _mm256_srli_epi16(sum, 8);
+    __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(luma, luma), 0x08);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(bytes));
+}
+
+// 8 chroma bytes from 32 bit block sums, saturating like ClampByte()
+TARGET_AVX2 static inline void StoreChroma(Uint8* dst, __m256i r, __m256i g, __m256i b, int cr, int cg, int cb) {
+    __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(cr)), _mm256_mullo_epi32(g, _mm256_set1_epi32(cg))),
+                                   _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(cb)), _mm256_set1_epi32(512)));
+    __m256i chroma = _mm256_add_epi32(_mm256_srai_epi32(sum, 10), _mm256_set1_epi32(128));
+    __m256i words = _mm256_packs_epi32(chroma, chroma);
+    __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words, words), _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(bytes));
+}
+
+// 16 pixels of both rows per step, the chroma sums of a block come from adding the
+// rows and then each horizontal pair
+TARGET_AVX2 static void RowsToYuvAVX2(const Uint32* row0, const Uint32* row1, int width, Uint8* y0, Uint8* y1, Uint8* u, Uint8* v) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i r0, g0, b0, r1, g1, b1;
+        SplitChannels(row0 + x, &r0, &g0, &b0);
+        SplitChannels(row1 + x, &r1, &g1, &b1);
+        StoreLuma(y0 + x, r0, g0, b0);
+        StoreLuma(y1 + x, r1, g1, b1);
+
+        __m256i r = _mm256_madd_epi16(_mm256_add_epi16(r0, r1), ones);
+        __m256i g = _mm256_madd_epi16(_mm256_add_epi16(g0, g1), ones);
+        __m256i b = _mm256_madd_epi16(_mm256_add_epi16(b0, b1), ones);
+        StoreChroma(u + x / 2, r, g, b, -43, -85, 128);
+        StoreChroma(v + x / 2, r, g, b, 128, -107, -21);
+    }
+
+    RowsToYuvScalar(row0 + x, row1 + x, width - x, y0 + x, y1 + x, u + x / 2, v + x / 2);
+}
+
+const YuvKernel yuvKernels[] = {
+    { "scalar", RowsToYuvScalar, AlwaysSupported },
+    { "avx2", RowsToYuvAVX2, HasAVX2 },
+};
+
+#else
+
+const YuvKernel yuvKernels[] = {
+    { "scalar", RowsToYuvScalar, AlwaysSupported },
+};
+
+#endif
+
+const int yuvKernelCount = sizeof(yuvKernels) / sizeof(yuvKernels[0]);
+
+// Nearest neighbour, the frames of a dynamic resolution run come in at every size
+static const Uint32* ScaleToVideo(const CaptureSlot* slot) {
+    if (slot->width == videoW && slot->height == videoH) return slot->pixels;
+
+    for (int x = 0; x < videoW; x++) sourceColumn[x] = x * slot->width / videoW;
+    for (int y = 0; y < videoH; y++) {
+        const Uint32* src = slot->pixels + (y * slot->height / videoH) * slot->width;
+        Uint32* dst = scaled + y * videoW;
+        for (int x = 0; x < videoW; x++) dst[x] = src[sourceColumn[x]];
+    }
+    return scaled;
+}
+
+static void WriteSlot(const CaptureSlot* slot) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    const Uint32* frame = ScaleToVideo(slot);
+
+    size_t lumaSize = static_cast<size_t>(videoW) * videoH;
+    Uint8* luma = planes;
+    Uint8* u = planes + lumaSize;
+    Uint8* v = u + lumaSize / 4;
+    for (int y = 0; y < videoH; y += 2) {
+        yuv(frame + y * videoW, frame + (y + 1) * videoW, videoW, luma + y * videoW, luma + (y + 1) * videoW, u + y / 2 * (videoW / 2), v + y / 2 * (videoW / 2));
+    }
+
+    size_t size = lumaSize * 3 / 2;
+    if (fputs("FRAME\n", file) >= 0 && fwrite(planes, 1, size, file) == size) captureStats.written++;
+    captureStats.writeMs += static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static void WriterLoop() {
+    for (;;) {
+        Uint32 head = slotHead.load(std::memory_order_relaxed);
+        if (head == slotTail.load(std::memory_order_acquire)) {
+            // only stops once the ring is empty, so every copied frame is written
+            if (stopping.load()) return;
+            std::unique_lock<std::mutex> guard(wakeLock);
+            wakeWriter.wait(guard, [head] { return stopping.load() || slotTail.load(std::memory_order_acquire) != head; });
+            continue;
+        }
+
+        WriteSlot(&slots[head % CAPTURE_SLOTS]);
+        slotHead.store(head + 1, std::memory_order_release);
+    }
+}
+
+static void WakeWriter() {
+    // taking the lock orders the new tail before the writer's check of it
+    { std::lock_guard<std::mutex> guard(wakeLock); }
+    wakeWriter.notify_one();
+}
+
+int StartCapture(const char* fileName, int width, int height, int fps) {
+    StopCapture();
+    videoW = width & ~1;
+    videoH = height & ~1;
+    if (videoW < 2 || videoH < 2) {
+        printf("Can not capture %dx%d frames\n", width, height);
+        return 0;
+    }
+
+    file = fopen(fileName, "wb");
+    if (!file) {
+        printf("Could not open %s for writing\n", fileName);
+        return 0;
+    }
+    fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", videoW, videoH, fps > 0 ? fps : 60);
+
+    // touched now so the first frames do not pay for the page faults
+    size_t slotPixels = WINDOW_W * WINDOW_H;
+    slotMemory = static_cast<Uint32*>(malloc(CAPTURE_SLOTS * slotPixels * sizeof(Uint32)));
+    memset(slotMemory, 0, CAPTURE_SLOTS * slotPixels * sizeof(Uint32));
+    for (int s = 0; s < CAPTURE_SLOTS; s++) slots[s].pixels = slotMemory + s * slotPixels;
+    scaled = static_cast<Uint32*>(malloc(static_cast<size_t>(videoW) * videoH * sizeof(Uint32)));
+    sourceColumn = static_cast<int*>(malloc(videoW * sizeof(int)));
+    planes = static_cast<Uint8*>(malloc(static_cast<size_t>(videoW) * videoH * 3 / 2));
+
+    for (int k = 0; k < yuvKernelCount; k++) {
+        if (yuvKernels[k].supported()) yuv = yuvKernels[k].fn;
+    }
+
+    memset(&captureStats, 0, sizeof(captureStats));
+    slotHead = 0;
+    slotTail = 0;
+    stopping = 0;
+    capturing = 1;
+    writer = std::thread(WriterLoop);
+
+    // a waiting writer would block the exit in the condition variable's destructor
+    static int atExitSet = 0;
+    if (!atExitSet) atexit(StopCapture);
+    atExitSet = 1;
+    return 1;
+}
+
+void CaptureFrame() {
+    if (!capturing) return;
+    PROFILE_SCOPE("capture");
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    Uint32 tail = slotTail.load(std::memory_order_relaxed);
+    if (tail - slotHead.load(std::memory_order_acquire) == CAPTURE_SLOTS) {
+        captureStats.dropped++;
+    } else {
+        CaptureSlot* slot = &slots[tail % CAPTURE_SLOTS];
+        slot->width = screenW;
+        slot->height = screenH;
+        memcpy(slot->pixels, frameBuffer, static_cast<size_t>(screenW) * screenH * sizeof(Uint32));
+        slotTail.store(tail + 1, std::memory_order_release);
+        captureStats.frames++;
+        WakeWriter();
+    }
+
+    double ms = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    captureStats.copyMs += ms;
+    if (ms > captureStats.copyMaxMs) captureStats.copyMaxMs = ms;
+}
+
+void StopCapture() {
+    if (!capturing) return;
+    stopping = 1;
+    WakeWriter();
+    writer.join();
+    capturing = 0;
+
+    fclose(file);
+    file = NULL;
+    free(slotMemory);
+    free(scaled);
+    free(sourceColumn);
+    free(planes);
+    slotMemory = NULL;
+    scaled = NULL;
+    sourceColumn = NULL;
+    planes = NULL;
+}
+
+int Capturing() {
+    return capturing;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+#include <stddef.h>
+
+// Records the finished frames to an uncompressed Y4M video for QA and perf runs.
+// CaptureFrame() only copies the frame into a free slot of a preallocated ring
+// and a writer thread scales it to the video size, converts it to 4:2:0 YUV and
+// writes it out. When the disk falls behind and every slot is still waiting the
+// frame is dropped and counted, the game never waits for the writer.
+//
+// Colors are converted with the full range BT.601 matrix of JPEG, C420jpeg in the
+// header. Chroma is taken from the sum of each 2x2 block of pixels.
+
+#define CAPTURE_SLOTS 8 // frames copied but not yet written, at window size each
+
+// Converts two rows of ARGB pixels, width of them and width even, into their
+// luma rows and one row of each chroma plane
+typedef void (*YuvFunc)(const Uint32* row0, const Uint32* row1, int width, Uint8* y0, Uint8* y1, Uint8* u, Uint8* v);
+
+typedef struct {
+    const char* name;
+    YuvFunc fn;
+    int (*supported)();
+} YuvKernel;
+
+// Every kernel compiled into this build, scalar first. All of them give the
+// same bytes.
+extern const YuvKernel yuvKernels[];
+extern const int yuvKernelCount;
+
+typedef struct {
+    int frames;       // copied into the ring
+    int dropped;      // came while every slot was still waiting for the writer
+    int written;      // by the writer, only final after StopCapture()
+    double copyMs;    // main thread time in CaptureFrame(), summed
+    double copyMaxMs;
+    double writeMs;   // writer thread time scaling, converting and writing, summed
+} CaptureStats;
+
+extern CaptureStats captureStats;
+
+// Creates fileName and starts the writer. Every frame is scaled to width x height,
+// rounded down to even sides, and the header says fps frames per second. Returns
+// 0 and prints why on failure.
+int StartCapture(const char* fileName, int width, int height, int fps);
+
+// Hands the screenW x screenH frame in frameBuffer to the writer, or drops it
+void CaptureFrame();
+
+// Waits for the writer to finish the frames in the ring and closes the file
+void StopCapture();
+
+int Capturing();
@@ -0,0 +1,25 @@
+#include "cpu.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+int AlwaysSupported() {
+    return 1;
+}
+
+int HasAVX2() {
+#if !defined(DOOM_X86)
+    return 0;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+    __cpuid(info, 1);
+    int osxsave = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1;
+    __cpuidex(info, 7, 0);
+    return osxsave && avx && ((info[1] >> 5) & 1) && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
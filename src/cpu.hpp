@@ -0,0 +1,20 @@
+#pragma once
+
+// CPU feature checks for the kernels that pick a SIMD path at runtime. Vector
+// code is compiled per function with TARGET_AVX2, so the rest of the build keeps
+// its baseline instruction set and older CPUs never run it. SSE2 code is compiled
+// plainly because every x86-64 CPU has it, so 32 bit x86 builds only get the
+// scalar kernels.
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DOOM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+int AlwaysSupported();
+int HasAVX2();
@@ -0,0 +1,141 @@
+#include "demo.hpp"
+#include "engine.hpp"
+#include "level.hpp"
+#include "sim.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Demo demo;
+
+void DemoRecordStart() {
+    DemoFree();
+    demo.header.magic = DEMO_MAGIC;
+    demo.header.version = DEMO_VERSION;
+    demo.header.tickRate = SIM_HZ;
+    demo.header.wallCount = level.wallCount;
+    demo.header.flags = texturedWalls ? 0 : DEMO_FLAG_FLAT;
+    demo.header.camX = cam.camPos.x;
+    demo.header.camY = cam.camPos.y;
+    demo.header.camAngle = cam.camAngle;
+    demo.header.stepWave = cam.stepWave;
+    demo.recording = 1;
+}
+
+void DemoRecordTick(PlayerInput input) {
+    if (!demo.recording) return;
+    if (static_cast<int>(demo.header.tickCount) == demo.capacity) {
+        int capacity = demo.capacity ? demo.capacity * 2 : DEMO_INITIAL_TICKS;
+        Uint8* ticks = static_cast<Uint8*>(realloc(demo.ticks, capacity));
+        if (!ticks) {
+            printf("Out of memory, demo recording stopped after %u ticks\n", demo.header.tickCount);
+            demo.recording = 0;
+            return;
+        }
+        demo.ticks = ticks;
+        demo.capacity = capacity;
+    }
+
+    demo.ticks[demo.header.tickCount++] =
+        (input.forward ? DEMO_FORWARD : 0) |
+        (input.back ? DEMO_BACK : 0) |
+        (input.left ? DEMO_LEFT : 0) |
+        (input.right ? DEMO_RIGHT : 0);
+}
+
+int DemoSave(const char* fileName) {
+    FILE* file = fopen(fileName, "wb");
+    if (!file) {
+        printf("Could not open %s for writing\n", fileName);
+        return 0;
+    }
+
+    int ok = fwrite(&demo.header, sizeof(demo.header), 1, file) == 1 &&
+        fwrite(demo.ticks, 1, demo.header.tickCount, file) == demo.header.tickCount;
+    fclose(file);
+    if (!ok) printf("Could not write demo %s\n", fileName);
+    return ok;
+}
+
+int DemoLoad(const char* fileName) {
+    DemoFree();
+    FILE* file = fopen(fileName, "rb");
+    if (!file) {
+        printf("Could not open demo %s\n", fileName);
+        return 0;
+    }
+
+    DemoHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != DEMO_MAGIC) {
+        printf("%s is not a demo file\n", fileName);
+        fclose(file);
+        return 0;
+    }
+    if (header.version != DEMO_VERSION) {
+        printf("Demo version %u, expected %u\n", header.version, DEMO_VERSION);
+        fclose(file);
+        return 0;
+    }
+    if (header.tickRate != SIM_HZ) {
+        printf("Demo recorded at %u ticks per second, this build runs %d\n", header.tickRate, SIM_HZ);
+        fclose(file);
+        return 0;
+    }
+    if (header.wallCount != static_cast<Uint32>(level.wallCount)) {
+        printf("Demo was recorded on a level with %u walls, this one has %d\n", header.wallCount, level.wallCount);
+        fclose(file);
+        return 0;
+    }
+
+    demo.ticks = static_cast<Uint8*>(malloc(header.tickCount ? header.tickCount : 1));
+    if (!demo.ticks || fread(demo.ticks, 1, header.tickCount, file) != header.tickCount) {
+        printf("Demo %s is truncated\n", fileName);
+        fclose(file);
+        DemoFree();
+        return 0;
+    }
+    fclose(file);
+
+    demo.header = header;
+    demo.capacity = header.tickCount;
+    texturedWalls = !(header.flags & DEMO_FLAG_FLAT);
+
+    cam.camPos.x = header.camX;
+    cam.camPos.y = header.camY;
+    cam.oldCamPos = cam.camPos;
+    cam.camAngle = header.camAngle;
+    cam.stepWave = header.stepWave;
+    return 1;
+}
+
+PlayerInput DemoInput(void* userData) {
+    PlayerInput input;
+    memset(&input, 0, sizeof(input));
+    if (DemoFinished()) return input;
+
+    Uint8 bits = demo.ticks[demo.position++];
+    input.forward = (bits & DEMO_FORWARD) != 0;
+    input.back = (bits & DEMO_BACK) != 0;
+    input.left = (bits & DEMO_LEFT) != 0;
+    input.right = (bits & DEMO_RIGHT) != 0;
+    return input;
+}
+
+int DemoFinished() {
+    return demo.position >= static_cast<int>(demo.header.tickCount);
+}
+
+void DemoFree() {
+    free(demo.ticks);
+    memset(&demo, 0, sizeof(demo));
+}
+
+Uint64 HashFrame() {
+    Uint64 hash = 1469598103934665603ull;
+    for (int i = 0; i < screenW * screenH; i++) {
+        hash ^= frameBuffer[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
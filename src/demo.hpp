@@ -0,0 +1,60 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// Demo files record a run as the camera before the first tick plus the input of
+// every simulation tick. The simulation only ever steps by SIM_DT, so feeding the
+// same input back tick by tick puts the camera in the same place bit for bit, no
+// matter how fast the frames come. All values are little endian.
+//
+//   DemoHeader
+//   Uint8 ticks[tickCount]   DEMO_FORWARD | DEMO_BACK | DEMO_LEFT | DEMO_RIGHT
+
+#define DEMO_MAGIC 0x4F4D4544 // "DEMO"
+#define DEMO_VERSION 1
+#define DEMO_INITIAL_TICKS 4096
+
+#define DEMO_FORWARD 1
+#define DEMO_BACK 2
+#define DEMO_LEFT 4
+#define DEMO_RIGHT 8
+
+#define DEMO_FLAG_FLAT 1 // recorded with flat shaded walls
+
+typedef struct {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 tickRate;  // SIM_HZ of the build that recorded it
+    Uint32 tickCount;
+    Uint32 wallCount; // of the level it was recorded on, playback refuses other levels
+    Uint32 flags;
+    float camX, camY, camAngle, stepWave;
+} DemoHeader;
+
+typedef struct {
+    DemoHeader header;
+    Uint8* ticks;
+    int capacity;
+    int position;  // next tick to play back
+    int recording;
+} Demo;
+
+extern Demo demo;
+
+// Starts recording from the current cam
+void DemoRecordStart();
+void DemoRecordTick(PlayerInput input);
+int DemoSave(const char* fileName);
+
+// Reads a demo made on the loaded level and puts cam at its start,
+// returns 0 and prints why on failure
+int DemoLoad(const char* fileName);
+
+// SampleInputFunc for playback, gives no input once the demo ran out
+PlayerInput DemoInput(void* userData);
+int DemoFinished();
+
+void DemoFree();
+
+// FNV-1a over the visible part of frameBuffer
+Uint64 HashFrame();
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "arena.hpp"
+#include "level.hpp"
+#include "texture.hpp"
+#include "typedefs.hpp"
+
+#define WINDOW_W 1152
+#define WINDOW_H 758
+#ifndef RES_DIV
+#define RES_DIV 3 // the render resolution starts at the window size divided by this
+#endif
+
+#define MOV_SPEED 100
+#define ROT_SPEED 3
+#define WWAVE_MAG 15
+
+#define POL_RES 1.025 // point on line check resolution
+
+#define EXPAND_ROWS 16 // framebuffer rows per palette expansion job
+#define FRAME_ARENA_SIZE (256 * 1024) // starting size, grows to the largest frame seen
+
+#define DEFAULT_LEVEL "maps/default.lvl" // built from maps/default.txt next to the executables
+
+// Filled by Init()
+typedef struct {
+    double levelMs;    // mapping and validating the level file
+    double bspBuildMs;
+    double gridBuildMs;
+} LoadStats;
+
+// Global variables
+extern Camera cam;     // simulation state, moved by the fixed timestep ticks
+extern Camera viewCam; // what the renderer draws from, cam interpolated between ticks
+extern LoadStats loadStats;
+
+// Internal render resolution, changed between frames by SetRenderResolution(). The
+// buffers are sized for the window and hold screenW * screenH packed pixels.
+extern int screenW, screenH;
+extern Uint8 indexBuffer[WINDOW_W * WINDOW_H]; // palette indices, what the renderer draws
+extern Uint32 frameBuffer[WINDOW_W * WINDOW_H]; // expanded from indexBuffer for upload
+
+extern Texture wallTexture;   // built in, drawn until the streamed one is loaded
+extern int wallTextureAsset;  // handle of the texture file in the asset cache, -1 for none
+extern int texturedWalls; // 0 draws flat distance shaded walls
+#define TEXTURE_TOGGLE_KEY SDLK_F4
+
+// Wall pipelines. Every combination of fill, shading and stride, how many columns
+// share one computed span, is its own specialization of the wall rasterizer, and
+// the table holds them all so one binary can draw or benchmark any of them. There
+// is no pixel format choice, every stage draws palette indices and ExpandFrame()
+// converts them once with its own kernels.
+typedef enum { FILL_WIREFRAME, FILL_FLAT, FILL_TEXTURED } WallFill;
+typedef enum { SHADE_DISTANCE, SHADE_NONE } WallShade;
+
+typedef int (*RasterizeWallFunc)(const ScreenSpacePoly* wall, const Texture* texture, Uint8 color, const Uint8* colormap, int bandStart, int bandEnd);
+
+typedef struct {
+    const char* name; // "textured", "flat_unlit_2", "wireframe_4", ...
+    int fill, shade, stride;
+    RasterizeWallFunc rasterizeWall;
+} RenderPipeline;
+
+extern const RenderPipeline renderPipelines[];
+extern const int renderPipelineCount;
+#define DEFAULT_RENDER_PIPELINE 0 // textured, distance shaded, every column on its own
+#define PIPELINE_CYCLE_KEY SDLK_F5
+
+// Index into renderPipelines the next frame draws with. With texturedWalls off a
+// textured pipeline draws flat.
+extern int renderPipeline;
+
+// Index of the pipeline called name, -1 when there is none
+int FindRenderPipeline(const char* name);
+
+// Filled by ProjectWalls() every frame
+typedef struct {
+    int sectorsVisited; // sector visits through portals, 0 when the BSP was walked
+    int wallsVisited;   // walls and wall pieces considered for projection
+} VisibilityStats;
+
+extern Arena frameArena;
+extern int screenSpaceVisiblePlanes;
+extern ScreenSpacePoly* screenSpacePolys;
+extern VisibilityStats visibility;
+
+// World
+int Init(const char* levelFile, const char* textureFile);
+void Shutdown();
+void CameraTranslate(PlayerInput input, double deltaTime);
+
+// Render, the stages run in this order by Render()
+Uint32 PackColor(Uint8 r, Uint8 g, Uint8 b);
+void PutPixel(int x, int y, Uint8 r, Uint8 g, Uint8 b);
+void FillRow(int y, int x0, int x1, Uint32 color);
+int IsFrontFace(Vec2 Camera, Vec2 pointA, Vec2 pointB);
+int PointInPoly(int nvert, float *vertx, float *verty, float testx, float testy);
+void DrawColumn(Uint8* dst, int pitch, int count, Uint8 color);
+void DrawTexturedColumn(Uint8* dst, int pitch, int count, const Uint8* texels, int mask, int shift, Sint32 v, Sint32 vStep, const Uint8* colormap);
+void AllocRenderBuffers();
+void SetRenderResolution(int width, int height);
+void FreeRenderBuffers();
+void BeginFrame();
+void ProjectWalls();
+void ProjectSprites();
+void Rasterize();
+void ExpandFrame();
+void Render();
+
+// Math
+float Cross2dPoints(float x1, float y1, float x2, float y2);
+Vec2 Intersection(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4);
+float DotPoints(float x1, float y1, float x2, float y2);
+float Dot(Vec2 pointA, Vec2 pointB);
+Vec2 Normalize(Vec2 vec);
+Vec2 VecMinus(Vec2 v1, Vec2 v2);
+Vec2 VecPlus(Vec2 v1, Vec2 v2);
+Vec2 VecMulF(Vec2 v1, float val);
+float Len(Vec2 pointA, Vec2 pointB);
+
+// Physics
+Vec2 ClosestPointOnLine(LineSeg line, Vec2 point);
+int IsPointOnLine(LineSeg line, Vec2 point);
+int LineCircleCollision(LineSeg line, Vec2 circleCenter, float circleRadius);
+Vec2 ResolveCollision(Vec2 lastPosition, Vec2 currentPosition, LineSeg lineOfCollision, float deltaTime);
+void CollisionDetection(float deltaTime);
@@ -0,0 +1,87 @@
+#include "fixed.hpp"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CORDIC_STEPS 30
+#define CORDIC_GAIN 652032874 // product of 1 / sqrt(1 + 2^-2k) in 2.30
+
+Fixed fineSine[FINE_ANGLES * 5 / 4];
+Uint32 reciprocalTable[1 << RECIPROCAL_BITS];
+
+// atan(2^-k) as binary angles
+static const Sint64 cordicAngles[CORDIC_STEPS] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+    2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861, 10430, 5215, 2608,
+    1304, 652, 326, 163, 81, 41, 20, 10, 5, 3, 1
+};
+
+// Rotates (gain, 0) by the angle in shrinking atan steps, y ends up as the sine in
+// 2.30. Converges for angles up to about 99 degrees, so only a quarter turn is used.
+static Fixed CordicSin(Sint64 angle) {
+    Sint64 x = CORDIC_GAIN, y = 0;
+    for (int k = 0; k < CORDIC_STEPS; k++) {
+        Sint64 dx = y >> k, dy = x >> k;
+        if (angle >= 0) {
+            x -= dx;
+            y += dy;
+            angle -= cordicAngles[k];
+        } else {
+            x += dx;
+            y -= dy;
+            angle += cordicAngles[k];
+        }
+    }
+    return static_cast<Fixed>((y + (1 << 13)) >> 14);
+}
+
+void BuildFixedTables() {
+    const int quarter = FINE_ANGLES / 4;
+    for (int i = 0; i <= quarter; i++) {
+        Fixed s = CordicSin(static_cast<Sint64>(i) << (32 - FINE_ANGLE_BITS));
+        fineSine[i] = s;
+        fineSine[quarter * 2 - i] = s;
+        fineSine[quarter * 2 + i] = -s;
+        if (i < quarter) fineSine[FINE_ANGLES - i] = -s;
+    }
+    for (int i = 0; i < quarter; i++) fineSine[FINE_ANGLES + i] = fineSine[i];
+
+    for (int i = 0; i < (1 << RECIPROCAL_BITS); i++) {
+        Uint64 m = (static_cast<Uint64>(1) << RECIPROCAL_BITS) + i;
+        reciprocalTable[i] = static_cast<Uint32>(((static_cast<Uint64>(1) << (31 + RECIPROCAL_BITS)) + m / 2) / m);
+    }
+}
+
+// Index of the highest set bit, x > 0
+static inline int LeadingBit(Uint32 x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - __builtin_clz(x);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, x);
+    return static_cast<int>(index);
+#else
+    int lead = 31;
+    while (!(x >> lead)) lead--;
+    return lead;
+#endif
+}
+
+Uint32 Reciprocal(Uint32 x, int bits) {
+    int lead = LeadingBit(x);
+
+    // m is x with the leading one moved to bit 31, a mantissa in [1, 2) as 1.31
+    Uint64 m = static_cast<Uint64>(x) << (31 - lead);
+    Uint64 r = reciprocalTable[(m >> (31 - RECIPROCAL_BITS)) & ((1 << RECIPROCAL_BITS) - 1)];
+
+    // r += r * (1 - m * r), everything in .31
+    Sint64 error = static_cast<Sint64>((static_cast<Uint64>(1) << 62) - m * r) >> 31;
+    r = static_cast<Uint64>(static_cast<Sint64>(r) + ((static_cast<Sint64>(r) * error) >> 31));
+
+    // 1 / x is r * 2^-(31 + lead)
+    int shift = bits - 31 - lead;
+    if (shift < 0) return -shift < 64 ? static_cast<Uint32>(r >> -shift) : 0;
+    if (shift >= 32 || (r << shift) > 0xFFFFFFFF) return 0xFFFFFFFF;
+    return static_cast<Uint32>(r << shift);
+}
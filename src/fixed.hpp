@@ -0,0 +1,71 @@
+#pragma once
+
+#include <SDL2/SDL_stdinc.h>
+#include <stdint.h>
+
+// 16.16 fixed point, binary angles and the tables behind them, used by the
+// DOOM_FIXED_POINT backend. Everything here is integer math, so it gives the same
+// bits with every compiler and CPU.
+//
+// An Angle is a binary angle, the full turn is 2^32 and wraps by itself. fineSine
+// holds FINE_ANGLES steps of a full turn plus a quarter more, so cosine reads the
+// same table a quarter turn on. It is built with integer CORDIC rather than libm,
+// whose last bits differ between platforms. Reciprocals start from a table of
+// 1 / m for the mantissa m in [1, 2) and take one Newton step.
+
+#define FRACBITS 16
+#define FRACUNIT (1 << FRACBITS)
+#define FINE_ANGLE_BITS 13
+#define FINE_ANGLES (1 << FINE_ANGLE_BITS)
+#define RECIPROCAL_BITS 10
+#define ANGLES_PER_RADIAN 683565275.5764316 // 2^32 / 2 pi
+
+typedef Sint32 Fixed;
+typedef Uint32 Angle;
+
+extern Fixed fineSine[FINE_ANGLES * 5 / 4];
+extern Uint32 reciprocalTable[1 << RECIPROCAL_BITS]; // 2^31 / (1 + i / 2^RECIPROCAL_BITS)
+
+// Init() builds them before anything else runs
+void BuildFixedTables();
+
+inline Fixed FloatToFixed(float f) {
+    return static_cast<Fixed>(f * FRACUNIT);
+}
+
+inline float FixedToFloat(Fixed f) {
+    return static_cast<float>(f) * (1.0f / FRACUNIT);
+}
+
+// For 16.16 values computed in 64 bits that may not fit a Fixed
+inline float FixedWideToFloat(Sint64 f) {
+    return static_cast<float>(f) * (1.0f / FRACUNIT);
+}
+
+inline Fixed FixedMul(Fixed a, Fixed b) {
+    return static_cast<Fixed>((static_cast<Sint64>(a) * b) >> FRACBITS);
+}
+
+// Saturates instead of overflowing when the quotient does not fit
+inline Fixed FixedDiv(Fixed a, Fixed b) {
+    Sint64 q = b ? (static_cast<Sint64>(a) * FRACUNIT) / b : (a < 0 ? INT32_MIN : INT32_MAX);
+    if (q > INT32_MAX) return INT32_MAX;
+    if (q < INT32_MIN) return INT32_MIN;
+    return static_cast<Fixed>(q);
+}
+
+// Any angle in radians, wrapped into a full turn
+inline Angle AngleFromRadians(float radians) {
+    return static_cast<Angle>(static_cast<Sint64>(radians * ANGLES_PER_RADIAN));
+}
+
+inline Fixed FixedSin(Angle angle) {
+    return fineSine[angle >> (32 - FINE_ANGLE_BITS)];
+}
+
+inline Fixed FixedCos(Angle angle) {
+    return fineSine[(angle >> (32 - FINE_ANGLE_BITS)) + FINE_ANGLES / 4];
+}
+
+// 2^bits / x for x > 0, to about 20 significant bits
+Uint32 Reciprocal(Uint32 x, int bits);
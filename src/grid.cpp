@@ -0,0 +1,193 @@
+#include "grid.hpp"
+#include "engine.hpp"
+#include "level.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+WallGrid wallGrid;
+
+static int CellCoord(float v, float origin, int size) {
+    int c = static_cast<int>(floorf((v - origin) * wallGrid.invCellSize));
+    if (c < 0) return 0;
+    if (c >= size) return size - 1;
+    return c;
+}
+
+// Cells are only tested inside the wall's bounding box, so the wall touches the
+// cell unless all four corners lie strictly on one side of its line
+static int WallTouchesCell(Vec2 p1, Vec2 p2, int cx, int cy) {
+    float x0 = wallGrid.originX + cx * wallGrid.cellSize;
+    float y0 = wallGrid.originY + cy * wallGrid.cellSize;
+    float x1 = x0 + wallGrid.cellSize, y1 = y0 + wallGrid.cellSize;
+    float dx = p2.x - p1.x, dy = p2.y - p1.y;
+
+    float s0 = dx * (y0 - p1.y) - dy * (x0 - p1.x);
+    float s1 = dx * (y0 - p1.y) - dy * (x1 - p1.x);
+    float s2 = dx * (y1 - p1.y) - dy * (x0 - p1.x);
+    float s3 = dx * (y1 - p1.y) - dy * (x1 - p1.x);
+
+    if (s0 > 0 && s1 > 0 && s2 > 0 && s3 > 0) return 0;
+    if (s0 < 0 && s1 < 0 && s2 < 0 && s3 < 0) return 0;
+    return 1;
+}
+
+// Runs visit(cell) for every cell the wall passes through
+template <typename Visit>
+static void ForEachWallCell(int w, Visit visit) {
+    Vec2 p1 = level.verts[level.walls[w].v1];
+    Vec2 p2 = level.verts[level.walls[w].v2];
+
+    int cx0 = CellCoord(fminf(p1.x, p2.x), wallGrid.originX, wallGrid.width);
+    int cx1 = CellCoord(fmaxf(p1.x, p2.x), wallGrid.originX, wallGrid.width);
+    int cy0 = CellCoord(fminf(p1.y, p2.y), wallGrid.originY, wallGrid.height);
+    int cy1 = CellCoord(fmaxf(p1.y, p2.y), wallGrid.originY, wallGrid.height);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            if (WallTouchesCell(p1, p2, cx, cy)) visit(cy * wallGrid.width + cx);
+        }
+    }
+}
+
+int BuildWallGrid() {
+    FreeWallGrid();
+    if (level.vertexCount == 0) return 0;
+
+    float minX = level.verts[0].x, maxX = minX;
+    float minY = level.verts[0].y, maxY = minY;
+    for (int i = 1; i < level.vertexCount; i++) {
+        minX = fminf(minX, level.verts[i].x);
+        maxX = fmaxf(maxX, level.verts[i].x);
+        minY = fminf(minY, level.verts[i].y);
+        maxY = fmaxf(maxY, level.verts[i].y);
+    }
+
+    float cellSize = GRID_CELL_SIZE;
+    double cells;
+    for (;;) {
+        cells = (floor((maxX - minX) / cellSize) + 1) * (floor((maxY - minY) / cellSize) + 1);
+        if (cells <= GRID_MAX_CELLS) break;
+        cellSize *= 2;
+    }
+
+    wallGrid.originX = minX;
+    wallGrid.originY = minY;
+    wallGrid.cellSize = cellSize;
+    wallGrid.invCellSize = 1.0f / cellSize;
+    wallGrid.width = static_cast<int>(floorf((maxX - minX) / cellSize)) + 1;
+    wallGrid.height = static_cast<int>(floorf((maxY - minY) / cellSize)) + 1;
+    wallGrid.wallCount = level.wallCount;
+
+    int cellCount = wallGrid.width * wallGrid.height;
+    wallGrid.cellStart = static_cast<int*>(calloc(cellCount + 1, sizeof(int)));
+    wallGrid.wallStamp = static_cast<Uint32*>(calloc(level.wallCount > 0 ? level.wallCount : 1, sizeof(Uint32)));
+
+    // count per cell, turn the counts into offsets, then fill
+    for (int w = 0; w < level.wallCount; w++) {
+        ForEachWallCell(w, [](int cell) { wallGrid.cellStart[cell + 1]++; });
+    }
+    for (int c = 0; c < cellCount; c++) wallGrid.cellStart[c + 1] += wallGrid.cellStart[c];
+
+    int* fill = static_cast<int*>(malloc((cellCount + 1) * sizeof(int)));
+    memcpy(fill, wallGrid.cellStart, (cellCount + 1) * sizeof(int));
+    wallGrid.cellWalls = static_cast<int*>(malloc((wallGrid.cellStart[cellCount] > 0 ? wallGrid.cellStart[cellCount] : 1) * sizeof(int)));
+    for (int w = 0; w < level.wallCount; w++) {
+        ForEachWallCell(w, [fill, w](int cell) { wallGrid.cellWalls[fill[cell]++] = w; });
+    }
+    free(fill);
+
+    return 1;
+}
+
+void FreeWallGrid() {
+    free(wallGrid.cellStart);
+    free(wallGrid.cellWalls);
+    free(wallGrid.wallStamp);
+    memset(&wallGrid, 0, sizeof(wallGrid));
+}
+
+void InitGridQuery(GridQuery* query) {
+    query->wallStamp = static_cast<Uint32*>(calloc(wallGrid.wallCount > 0 ? wallGrid.wallCount : 1, sizeof(Uint32)));
+    query->stamp = 0;
+}
+
+void FreeGridQuery(GridQuery* query) {
+    free(query->wallStamp);
+    query->wallStamp = NULL;
+}
+
+static void QueryCells(Uint32* wallStamp, Uint32* stamp, Vec2 boxMin, Vec2 boxMax, GridWallFunc visit, void* userData) {
+    if (!wallGrid.cellStart) return;
+
+    if (++*stamp == 0) {
+        memset(wallStamp, 0, wallGrid.wallCount * sizeof(Uint32));
+        *stamp = 1;
+    }
+
+    int cx0 = CellCoord(boxMin.x, wallGrid.originX, wallGrid.width);
+    int cx1 = CellCoord(boxMax.x, wallGrid.originX, wallGrid.width);
+    int cy0 = CellCoord(boxMin.y, wallGrid.originY, wallGrid.height);
+    int cy1 = CellCoord(boxMax.y, wallGrid.originY, wallGrid.height);
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            int cell = cy * wallGrid.width + cx;
+            for (int i = wallGrid.cellStart[cell]; i < wallGrid.cellStart[cell + 1]; i++) {
+                int w = wallGrid.cellWalls[i];
+                if (wallStamp[w] == *stamp) continue;
+                wallStamp[w] = *stamp;
+                visit(w, userData);
+            }
+        }
+    }
+}
+
+void QueryWallGrid(Vec2 boxMin, Vec2 boxMax, GridWallFunc visit, void* userData) {
+    QueryCells(wallGrid.wallStamp, &wallGrid.stamp, boxMin, boxMax, visit, userData);
+}
+
+void QueryWallGridWith(GridQuery* query, Vec2 boxMin, Vec2 boxMax, GridWallFunc visit, void* userData) {
+    QueryCells(query->wallStamp, &query->stamp, boxMin, boxMax, visit, userData);
+}
+
+typedef struct {
+    Vec2 pos;
+    float radius;
+    int crossings; // walls a ray from pos toward +x passes, odd inside a polygon
+    int touching;
+} SpotProbe;
+
+static void CountCrossing(int w, void* userData) {
+    SpotProbe* probe = static_cast<SpotProbe*>(userData);
+    Vec2 a = level.verts[level.walls[w].v1], b = level.verts[level.walls[w].v2];
+    if ((a.y > probe->pos.y) == (b.y > probe->pos.y)) return;
+    float x = a.x + (probe->pos.y - a.y) * (b.x - a.x) / (b.y - a.y);
+    if (x > probe->pos.x) probe->crossings++;
+}
+
+static void CheckTouch(int w, void* userData) {
+    SpotProbe* probe = static_cast<SpotProbe*>(userData);
+    LineSeg line;
+    line.p1 = level.verts[level.walls[w].v1];
+    line.p2 = level.verts[level.walls[w].v2];
+    if (LineCircleCollision(line, probe->pos, probe->radius)) probe->touching = 1;
+}
+
+int IsOpenSpot(Vec2 pos, float radius) {
+    SpotProbe probe;
+    probe.pos = pos;
+    probe.radius = radius;
+    probe.crossings = 0;
+    probe.touching = 0;
+
+    Vec2 boxMin = { pos.x - radius, pos.y - radius };
+    Vec2 boxMax = { pos.x + radius, pos.y + radius };
+    QueryWallGrid(boxMin, boxMax, CheckTouch, &probe);
+    if (probe.touching) return 0;
+
+    Vec2 rayEnd = { level.boundsMax.x + 1, pos.y };
+    QueryWallGrid(pos, rayEnd, CountCrossing, &probe);
+    return !(probe.crossings & 1);
+}
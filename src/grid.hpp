@@ -0,0 +1,48 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// Uniform grid over the level walls, built once at load. Every cell lists the
+// walls passing through it, so a collision query only looks at the walls in
+// the few cells its box overlaps no matter how large the level is.
+
+#define GRID_CELL_SIZE 64.0f     // world units
+#define GRID_MAX_CELLS (1 << 22) // cells grow past GRID_CELL_SIZE to stay under this
+
+typedef struct {
+    float originX, originY;
+    float cellSize, invCellSize;
+    int width, height;
+    int* cellStart;    // width * height + 1 offsets into cellWalls
+    int* cellWalls;    // wall indices grouped by cell
+    Uint32* wallStamp; // query that last returned each wall, so walls in several cells come out once
+    Uint32 stamp;
+    int wallCount;
+} WallGrid;
+
+extern WallGrid wallGrid;
+
+typedef void (*GridWallFunc)(int wall, void* userData);
+
+// Which walls one thread's query already returned. QueryWallGrid() has one of its
+// own, threads that query at the same time need one each.
+typedef struct {
+    Uint32* wallStamp;
+    Uint32 stamp;
+} GridQuery;
+
+int BuildWallGrid();
+void FreeWallGrid();
+
+// Calls visit once for every wall that passes through a cell the box overlaps,
+// not thread safe
+void QueryWallGrid(Vec2 boxMin, Vec2 boxMax, GridWallFunc visit, void* userData);
+
+// The same with the caller's state, safe while nothing rebuilds the grid. A query
+// needs the grid built before InitGridQuery().
+void InitGridQuery(GridQuery* query);
+void FreeGridQuery(GridQuery* query);
+void QueryWallGridWith(GridQuery* query, Vec2 boxMin, Vec2 boxMax, GridWallFunc visit, void* userData);
+
+// A circle there touches no wall and is not inside a polygon
+int IsOpenSpot(Vec2 pos, float radius);
@@ -0,0 +1,143 @@
+#include "jobs.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Each worker owns a contiguous range of job indices, it pops from the front
+// while idle workers steal from the back
+typedef struct {
+    std::mutex lock;
+    int head, tail;
+} JobQueue;
+
+static JobQueue queues[MAX_JOB_THREADS];
+static std::vector<std::thread> workers;
+static int threadCount = 1;
+
+static std::mutex poolLock;
+static std::condition_variable wakeWorkers;
+static std::condition_variable workersIdle;
+static unsigned generation = 0;
+static int activeWorkers = 0;
+static int quitting = 0;
+
+static JobFunc curFunc;
+static void* curUserData;
+static std::atomic<int> pendingJobs(0);
+
+static thread_local int workerIndex = 0;
+
+static int PopJob(int queueIdx) {
+    JobQueue* q = &queues[queueIdx];
+    std::lock_guard<std::mutex> guard(q->lock);
+    if (q->head >= q->tail) return -1;
+    return q->head++;
+}
+
+static int StealJob(int thiefIdx) {
+    for (int i = 1; i < threadCount; i++) {
+        JobQueue* q = &queues[(thiefIdx + i) % threadCount];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->head < q->tail) return --q->tail;
+    }
+    return -1;
+}
+
+static void WorkOnJobs(int queueIdx, JobFunc fn, void* userData) {
+    for (;;) {
+        int job = PopJob(queueIdx);
+        if (job < 0) job = StealJob(queueIdx);
+        if (job < 0) return;
+
+        fn(job, userData);
+        pendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+static void WorkerLoop(int queueIdx) {
+    unsigned seenGeneration = 0;
+    workerIndex = queueIdx;
+
+    for (;;) {
+        JobFunc fn;
+        void* userData;
+        {
+            std::unique_lock<std::mutex> guard(poolLock);
+            wakeWorkers.wait(guard, [&] { return quitting || generation != seenGeneration; });
+            if (quitting) return;
+
+            seenGeneration = generation;
+            fn = curFunc;
+            userData = curUserData;
+            activeWorkers++;
+        }
+
+        WorkOnJobs(queueIdx, fn, userData);
+
+        std::lock_guard<std::mutex> guard(poolLock);
+        if (--activeWorkers == 0) workersIdle.notify_all();
+    }
+}
+
+void JobsInit(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_JOB_THREADS) count = MAX_JOB_THREADS;
+    threadCount = count;
+    quitting = 0;
+
+    // the calling thread is worker 0
+    for (int i = 1; i < threadCount; i++) workers.emplace_back(WorkerLoop, i);
+}
+
+void JobsShutdown() {
+    {
+        std::lock_guard<std::mutex> guard(poolLock);
+        quitting = 1;
+    }
+    wakeWorkers.notify_all();
+
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+    threadCount = 1;
+}
+
+int JobsThreadCount() {
+    return threadCount;
+}
+
+int JobsThreadIndex() {
+    return workerIndex;
+}
+
+void JobsRun(int jobCount, JobFunc fn, void* userData) {
+    if (jobCount <= 0) return;
+
+    if (threadCount == 1) {
+        for (int i = 0; i < jobCount; i++) fn(i, userData);
+        return;
+    }
+
+    {
+        // a worker that woke up late for the previous batch may still be scanning the queues
+        std::unique_lock<std::mutex> guard(poolLock);
+        workersIdle.wait(guard, [] { return activeWorkers == 0; });
+
+        for (int i = 0; i < threadCount; i++) {
+            queues[i].head = jobCount * i / threadCount;
+            queues[i].tail = jobCount * (i + 1) / threadCount;
+        }
+        curFunc = fn;
+        curUserData = userData;
+        pendingJobs.store(jobCount, std::memory_order_relaxed);
+        generation++;
+    }
+    wakeWorkers.notify_all();
+
+    WorkOnJobs(0, fn, userData);
+
+    // jobs stolen by other workers may still be running
+    while (pendingJobs.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+}
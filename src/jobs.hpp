@@ -0,0 +1,19 @@
+#pragma once
+
+// Small work-stealing job pool. The calling thread works on the jobs too,
+// so a pool with one thread runs everything inline on the caller.
+
+#define MAX_JOB_THREADS 64
+
+typedef void (*JobFunc)(int jobIdx, void* userData);
+
+void JobsInit(int threadCount);
+void JobsShutdown();
+int JobsThreadCount();
+
+// 0 to JobsThreadCount() - 1 for the thread running the current job, the thread
+// that calls JobsRun() is 0. Lets jobs pick per thread scratch state.
+int JobsThreadIndex();
+
+// Runs fn(0..jobCount-1) across the pool and returns once every job is done
+void JobsRun(int jobCount, JobFunc fn, void* userData);
@@ -0,0 +1,215 @@
+#include "level.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Level level;
+
+static int TableFits(Uint32 offset, Uint32 count, size_t elemSize, size_t fileSize) {
+    if (offset % LEVEL_ALIGN != 0) return 0;
+    if (offset > fileSize) return 0;
+    return count <= (fileSize - offset) / elemSize;
+}
+
+static int ValidateSectors(const Uint8* data, const LevelHeader* header) {
+    const LevelSector* sectors = reinterpret_cast<const LevelSector*>(data + header->sectorOffset);
+    for (Uint32 i = 0; i < header->sectorCount; i++) {
+        if (sectors[i].edgeCount < 3 || sectors[i].firstEdge > header->sectorEdgeCount ||
+            sectors[i].edgeCount > header->sectorEdgeCount - sectors[i].firstEdge) {
+            printf("Sector %u has an edge range outside the table\n", i);
+            return 0;
+        }
+    }
+
+    const LevelSectorEdge* edges = reinterpret_cast<const LevelSectorEdge*>(data + header->sectorEdgeOffset);
+    for (Uint32 i = 0; i < header->sectorEdgeCount; i++) {
+        const LevelSectorEdge* edge = &edges[i];
+        int isWall = edge->wall != LEVEL_NONE, isPortal = edge->sector != LEVEL_NONE;
+        if (edge->v1 >= header->vertexCount || edge->v2 >= header->vertexCount ||
+            (isWall && edge->wall >= header->wallCount) || (isPortal && edge->sector >= header->sectorCount) || isWall == isPortal) {
+            printf("Sector edge %u must reference existing vertices and one wall or one sector\n", i);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int ValidateLevel(const Uint8* data, size_t size) {
+    if (size < LEVEL_V1_HEADER_SIZE) {
+        printf("Level is too small for a header\n");
+        return 0;
+    }
+
+    const LevelHeader* header = reinterpret_cast<const LevelHeader*>(data);
+    if (header->magic != LEVEL_MAGIC) {
+        printf("Not a level file\n");
+        return 0;
+    }
+    if (header->version < 1 || header->version > LEVEL_VERSION) {
+        printf("Level version %u, expected 1 to %u\n", header->version, LEVEL_VERSION);
+        return 0;
+    }
+    if (header->version >= 2 && size < sizeof(LevelHeader)) {
+        printf("Level is too small for a header\n");
+        return 0;
+    }
+    if (header->fileSize != size ||
+        !TableFits(header->vertexOffset, header->vertexCount, sizeof(Vec2), size) ||
+        !TableFits(header->wallOffset, header->wallCount, sizeof(LevelWall), size) ||
+        !TableFits(header->polyOffset, header->polyCount, sizeof(LevelPoly), size) ||
+        (header->version >= 2 && (!TableFits(header->sectorOffset, header->sectorCount, sizeof(LevelSector), size) ||
+            !TableFits(header->sectorEdgeOffset, header->sectorEdgeCount, sizeof(LevelSectorEdge), size)))) {
+        printf("Level tables do not fit the file\n");
+        return 0;
+    }
+
+    const LevelWall* walls = reinterpret_cast<const LevelWall*>(data + header->wallOffset);
+    for (Uint32 i = 0; i < header->wallCount; i++) {
+        if (walls[i].v1 >= header->vertexCount || walls[i].v2 >= header->vertexCount || walls[i].poly >= header->polyCount) {
+            printf("Wall %u references a missing vertex or polygon\n", i);
+            return 0;
+        }
+    }
+
+    const LevelPoly* polys = reinterpret_cast<const LevelPoly*>(data + header->polyOffset);
+    for (Uint32 i = 0; i < header->polyCount; i++) {
+        if (polys[i].firstVertex > header->vertexCount || polys[i].vertexCount > header->vertexCount - polys[i].firstVertex ||
+            polys[i].firstWall > header->wallCount || polys[i].wallCount > header->wallCount - polys[i].firstWall) {
+            printf("Polygon %u has a vertex or wall range outside the tables\n", i);
+            return 0;
+        }
+    }
+
+    return header->version < 2 || ValidateSectors(data, header);
+}
+
+int LoadLevelFromMemory(const void* data, size_t size) {
+    const Uint8* bytes = static_cast<const Uint8*>(data);
+    if (!ValidateLevel(bytes, size)) return 0;
+
+    const LevelHeader* header = reinterpret_cast<const LevelHeader*>(bytes);
+    level.header = header;
+    level.verts = reinterpret_cast<const Vec2*>(bytes + header->vertexOffset);
+    level.walls = reinterpret_cast<const LevelWall*>(bytes + header->wallOffset);
+    level.polys = reinterpret_cast<const LevelPoly*>(bytes + header->polyOffset);
+    level.vertexCount = header->vertexCount;
+    level.wallCount = header->wallCount;
+    level.polyCount = header->polyCount;
+    if (header->version >= 2 && header->sectorCount > 0) {
+        level.sectors = reinterpret_cast<const LevelSector*>(bytes + header->sectorOffset);
+        level.sectorEdges = reinterpret_cast<const LevelSectorEdge*>(bytes + header->sectorEdgeOffset);
+        level.sectorCount = header->sectorCount;
+        level.sectorEdgeCount = header->sectorEdgeCount;
+    } else {
+        level.sectors = NULL;
+        level.sectorEdges = NULL;
+        level.sectorCount = level.sectorEdgeCount = 0;
+    }
+
+    level.maxHeight = 0;
+    for (int i = 0; i < level.polyCount; i++) {
+        if (level.polys[i].height > level.maxHeight) level.maxHeight = level.polys[i].height;
+    }
+
+    level.boundsMin.x = level.boundsMin.y = level.boundsMax.x = level.boundsMax.y = 0;
+    if (level.vertexCount > 0) level.boundsMin = level.boundsMax = level.verts[0];
+    for (int i = 1; i < level.vertexCount; i++) {
+        Vec2 p = level.verts[i];
+        if (p.x < level.boundsMin.x) level.boundsMin.x = p.x;
+        if (p.y < level.boundsMin.y) level.boundsMin.y = p.y;
+        if (p.x > level.boundsMax.x) level.boundsMax.x = p.x;
+        if (p.y > level.boundsMax.y) level.boundsMax.y = p.y;
+    }
+    return 1;
+}
+
+#ifdef _WIN32
+
+int LoadLevel(const char* fileName) {
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        printf("Could not open level %s\n", fileName);
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        printf("Could not map level %s\n", fileName);
+        return 0;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data) {
+        printf("Could not map level %s\n", fileName);
+        return 0;
+    }
+
+    if (!LoadLevelFromMemory(data, static_cast<size_t>(size.QuadPart))) {
+        UnmapViewOfFile(data);
+        return 0;
+    }
+
+    level.mapping = data;
+    level.mappingSize = static_cast<size_t>(size.QuadPart);
+    return 1;
+}
+
+void UnloadLevel() {
+    if (level.mapping) UnmapViewOfFile(level.mapping);
+    memset(&level, 0, sizeof(level));
+}
+
+#else
+
+int LoadLevel(const char* fileName) {
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        printf("Could not open level %s\n", fileName);
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Could not read level %s\n", fileName);
+        close(fd);
+        return 0;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("Could not map level %s\n", fileName);
+        return 0;
+    }
+
+    if (!LoadLevelFromMemory(data, st.st_size)) {
+        munmap(data, st.st_size);
+        return 0;
+    }
+
+    level.mapping = data;
+    level.mappingSize = st.st_size;
+    return 1;
+}
+
+void UnloadLevel() {
+    if (level.mapping) munmap(level.mapping, level.mappingSize);
+    memset(&level, 0, sizeof(level));
+}
+
+#endif
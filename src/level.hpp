@@ -0,0 +1,94 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+#include <stddef.h>
+
+// Binary level format. The file is a header followed by flat tables, every
+// table starts on a LEVEL_ALIGN boundary so a memory mapped file is used in
+// place without any parsing. All values are little endian.
+//
+//   LevelHeader
+//   Vec2      verts[vertexCount]   shared vertex pool
+//   LevelWall walls[wallCount]     one wall per polygon edge
+//   LevelPoly polys[polyCount]     height plus vertex and wall ranges
+//   LevelSector     sectors[sectorCount]          version 2, optional
+//   LevelSectorEdge sectorEdges[sectorEdgeCount]  version 2, optional
+//
+// Sectors split the open space between the polygons into convex areas. Their
+// edges run counter-clockwise and are either a polygon wall or a portal into
+// the neighbouring sector, the renderer then only visits what it can see
+// through the portals. Version 1 files have no sectors and still load.
+
+#define LEVEL_MAGIC 0x4C56454C // "LEVL"
+#define LEVEL_VERSION 2
+#define LEVEL_ALIGN 16
+#define LEVEL_NONE 0xFFFFFFFF
+
+typedef struct {
+    Uint32 magic;
+    Uint32 version;
+    Uint32 fileSize;
+    Uint32 vertexCount;
+    Uint32 wallCount;
+    Uint32 polyCount;
+    Uint32 vertexOffset;
+    Uint32 wallOffset;
+    Uint32 polyOffset;
+    float spawnX, spawnY, spawnAngle;
+    // version 2, a version 1 header ends before these
+    Uint32 sectorCount;
+    Uint32 sectorEdgeCount;
+    Uint32 sectorOffset;
+    Uint32 sectorEdgeOffset;
+} LevelHeader;
+
+#define LEVEL_V1_HEADER_SIZE offsetof(LevelHeader, sectorCount)
+
+typedef struct {
+    Uint32 v1, v2; // indices into the vertex pool
+    Uint32 poly;
+    Uint32 flags;
+} LevelWall;
+
+typedef struct {
+    Uint32 firstVertex, vertexCount;
+    Uint32 firstWall, wallCount;
+    float height;
+} LevelPoly;
+
+typedef struct {
+    Uint32 firstEdge, edgeCount;
+} LevelSector;
+
+typedef struct {
+    Uint32 v1, v2; // indices into the vertex pool, the sector is on the left
+    Uint32 wall;   // wall along the edge, LEVEL_NONE for a portal
+    Uint32 sector; // sector behind a portal, LEVEL_NONE for a wall
+} LevelSectorEdge;
+
+typedef struct {
+    const LevelHeader* header;
+    const Vec2* verts;
+    const LevelWall* walls;
+    const LevelPoly* polys;
+    const LevelSector* sectors;         // NULL for a version 1 file, use the counts
+    const LevelSectorEdge* sectorEdges; // here and not the ones in the header
+    int vertexCount, wallCount, polyCount;
+    int sectorCount, sectorEdgeCount;
+    float maxHeight; // of the tallest polygon
+    Vec2 boundsMin, boundsMax; // of all vertices
+
+    void* mapping;
+    size_t mappingSize;
+} Level;
+
+extern Level level;
+
+// Maps a level file and checks every table and index against the file size,
+// returns 0 and prints why on failure
+int LoadLevel(const char* fileName);
+void UnloadLevel();
+
+// Uses an in-memory image with the same layout, the caller keeps it alive
+int LoadLevelFromMemory(const void* data, size_t size);
@@ -0,0 +1,124 @@
+#include "palette.hpp"
+#include "cpu.hpp"
+
+#include <string.h>
+
+Palette palette;
+
+// Brightest shade of every hue ramp after the grays, picked to cover the sky,
+// the flat walls and the kind of colors wall textures use
+static const Uint8 rampColors[][3] = {
+    { 230, 40, 30 },   // red
+    { 190, 90, 60 },   // brick
+    { 140, 95, 55 },   // brown
+    { 255, 150, 40 },  // orange
+    { 230, 190, 140 }, // tan
+    { 250, 230, 80 },  // yellow
+    { 120, 150, 60 },  // olive
+    { 0, 255, 0 },     // green, the flat shaded walls
+    { 60, 220, 220 },  // cyan
+    { 77, 181, 255 },  // sky
+    { 40, 60, 230 },   // blue
+    { 160, 60, 200 },  // purple
+    { 250, 150, 170 }, // pink
+    { 154, 154, 146 }, // mortar
+};
+
+static int ColorDistance(int r1, int g1, int b1, int r2, int g2, int b2) {
+    int dr = r1 - r2, dg = g1 - g2, db = b1 - b2;
+    return 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+}
+
+static Uint8 SearchNearest(int r, int g, int b) {
+    int best = 0, bestDist = 0x7FFFFFFF;
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        Uint32 c = palette.colors[i];
+        int dist = ColorDistance(r, g, b, (c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF);
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = i;
+        }
+    }
+    return static_cast<Uint8>(best);
+}
+
+void ExpandScalar(const Uint8* src, Uint32* dst, int count, const Uint32* colors) {
+    for (int i = 0; i < count; i++) dst[i] = colors[src[i]];
+}
+
+#ifdef DOOM_X86
+
+// Widens 8 indices to 32 bit and gathers their colors in one instruction
+TARGET_AVX2 static void ExpandAVX2(const Uint8* src, Uint32* dst, int count, const Uint32* colors) {
+    const int* table = reinterpret_cast<const int*>(colors);
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(indices), 4);
+        __m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8)), 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), hi);
+    }
+
+    ExpandScalar(src + i, dst + i, count - i, colors);
+}
+
+const ExpandKernel expandKernels[] = {
+    { "scalar", ExpandScalar, AlwaysSupported },
+    { "avx2", ExpandAVX2, HasAVX2 },
+};
+
+#else
+
+const ExpandKernel expandKernels[] = {
+    { "scalar", ExpandScalar, AlwaysSupported },
+};
+
+#endif
+
+const int expandKernelCount = sizeof(expandKernels) / sizeof(expandKernels[0]);
+
+void BuildPalette() {
+    memset(&palette, 0, sizeof(palette));
+
+    int index = 0;
+    for (int k = 0; k < PALETTE_RAMP * 2; k++) {
+        int v = k * 255 / (PALETTE_RAMP * 2 - 1);
+        palette.colors[index++] = 0xFF000000 | (v << 16) | (v << 8) | v;
+    }
+    for (const Uint8* base : rampColors) {
+        for (int k = 1; k <= PALETTE_RAMP; k++) {
+            int r = base[0] * k / PALETTE_RAMP, g = base[1] * k / PALETTE_RAMP, b = base[2] * k / PALETTE_RAMP;
+            palette.colors[index++] = 0xFF000000 | (r << 16) | (g << 8) | b;
+        }
+    }
+
+    for (int l = 0; l < LIGHT_LEVELS; l++) {
+        for (int i = 0; i < PALETTE_SIZE; i++) {
+            Uint32 c = palette.colors[i];
+            int r = ((c >> 16) & 0xFF) * l / (LIGHT_LEVELS - 1);
+            int g = ((c >> 8) & 0xFF) * l / (LIGHT_LEVELS - 1);
+            int b = (c & 0xFF) * l / (LIGHT_LEVELS - 1);
+            palette.colormaps[l][i] = SearchNearest(r, g, b);
+        }
+    }
+
+    // same falloff the flat walls always had: full light up to 0x55 units, then 0x55 / dist
+    for (int bucket = 0; bucket < LIGHT_DISTANCE_BUCKETS; bucket++) {
+        float dist = (bucket + 0.5f) * (1 << LIGHT_DISTANCE_SHIFT);
+        float light = 0x55 / dist;
+        if (light > 1) light = 1;
+        palette.distanceLight[bucket] = static_cast<Uint8>(light * (LIGHT_LEVELS - 1) + 0.5f);
+    }
+
+    // 5 bit channels, looked up at the middle of every cell
+    for (int i = 0; i < 32 * 32 * 32; i++) {
+        int r = ((i >> 10) & 31) * 8 + 4, g = ((i >> 5) & 31) * 8 + 4, b = (i & 31) * 8 + 4;
+        palette.inverse[i] = SearchNearest(r, g, b);
+    }
+
+    for (int k = 0; k < expandKernelCount; k++) {
+        if (expandKernels[k].supported()) palette.expand = expandKernels[k].fn;
+    }
+}
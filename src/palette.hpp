@@ -0,0 +1,49 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// The renderer draws palette indices into an 8 bit frame and expands it to 32 bit
+// once, right before upload. Lighting never touches RGB: colormap l maps every
+// index to the index closest to that color at brightness l / (LIGHT_LEVELS - 1),
+// so shading a pixel is one table load. The palette is a fixed set of ramps, dark
+// to bright, so a darkened color lands on a shade of its own hue.
+
+#define PALETTE_SIZE 256
+#define PALETTE_RAMP 16           // shades per hue, the gray ramp gets two
+#define LIGHT_LEVELS 32           // 0 is black, LIGHT_LEVELS - 1 is full brightness
+#define LIGHT_DISTANCE_SHIFT 2    // distance buckets are 4 units wide
+#define LIGHT_DISTANCE_BUCKETS 4096 // anything farther gets the last bucket
+
+typedef void (*ExpandFunc)(const Uint8* src, Uint32* dst, int count, const Uint32* colors);
+
+typedef struct {
+    const char* name;
+    ExpandFunc fn;
+    int (*supported)();
+} ExpandKernel;
+
+typedef struct {
+    Uint32 colors[PALETTE_SIZE]; // ARGB
+    Uint8 colormaps[LIGHT_LEVELS][PALETTE_SIZE];
+    Uint8 distanceLight[LIGHT_DISTANCE_BUCKETS]; // light level by distance bucket
+    Uint8 inverse[32 * 32 * 32]; // closest index to every 5:5:5 color
+    ExpandFunc expand;           // fastest kernel the CPU supports
+} Palette;
+
+extern Palette palette;
+
+// Every kernel compiled into this build, scalar first
+extern const ExpandKernel expandKernels[];
+extern const int expandKernelCount;
+
+void BuildPalette();
+
+static inline Uint8 NearestColor(Uint8 r, Uint8 g, Uint8 b) {
+    return palette.inverse[((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)];
+}
+
+static inline const Uint8* ColormapByDistance(float dist) {
+    int bucket = LIGHT_DISTANCE_BUCKETS - 1;
+    if (dist < (LIGHT_DISTANCE_BUCKETS << LIGHT_DISTANCE_SHIFT)) bucket = dist > 0 ? static_cast<int>(dist) >> LIGHT_DISTANCE_SHIFT : 0;
+    return palette.colormaps[palette.distanceLight[bucket]];
+}
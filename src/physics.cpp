@@ -0,0 +1,111 @@
+#include "engine.hpp"
+#include "grid.hpp"
+#include "profiler.hpp"
+
+#include <math.h>
+
+#define PLAYER_RADIUS 10.0f
+
+typedef struct {
+    float deltaTime;
+    int tests;
+} CollisionQuery;
+
+Vec2 ClosestPointOnLine(LineSeg line, Vec2 point) {
+    float lineLenSq = DotPoints(line.p2.x - line.p1.x, line.p2.y - line.p1.y, line.p2.x - line.p1.x, line.p2.y - line.p1.y);
+    if (lineLenSq == 0) return line.p1;
+
+    float dot =
+        (((point.x - line.p1.x) * (line.p2.x - line.p1.x)) +
+        ((point.y - line.p1.y) * (line.p2.y - line.p1.y))) /
+        lineLenSq;
+ 
+    if (dot > 1)
+        dot = 1;
+    else if (dot < 0)
+        dot = 0;
+       
+    Vec2 closestPoint;
+    closestPoint.x = line.p1.x + (dot * (line.p2.x - line.p1.x));
+    closestPoint.y = line.p1.y + (dot * (line.p2.y - line.p1.y));
+ 
+    return closestPoint;
+}
+ 
+int IsPointOnLine(LineSeg line, Vec2 point) {
+    float lineLen = Len(line.p1, line.p2);
+    float pointDist1 = Len(point, line.p1);
+    float pointDist2 = Len(point, line.p2);
+    float resolution = POL_RES;
+    float lineLenMarginHi = lineLen + resolution;
+    float lineLenMarginLo = lineLen - resolution;
+    float distFromLineEnds = pointDist1 + pointDist2;
+ 
+    if (distFromLineEnds >= lineLenMarginLo &&
+        distFromLineEnds <= lineLenMarginHi)
+        return 1;
+       
+    return 0;
+}
+
+// The closest point is clamped to the segment, so comparing squared distances
+// is enough and no square root is needed
+int LineCircleCollision(LineSeg line, Vec2 circleCenter, float circleRadius)
+{
+    Vec2 closestPointToLine = ClosestPointOnLine(line, circleCenter);
+    float dx = closestPointToLine.x - circleCenter.x;
+    float dy = closestPointToLine.y - circleCenter.y;
+   
+    if (dx * dx + dy * dy < circleRadius * circleRadius) return 1;
+ 
+    return 0;
+}
+ 
+Vec2 ResolveCollision(Vec2 lastPosition, Vec2 currentPosition, LineSeg lineOfCollision, float deltaTime) {
+    Vec2 dir = VecMinus(currentPosition, lastPosition);
+    Vec2 collisionPoint = ClosestPointOnLine(lineOfCollision, currentPosition);
+    Vec2 collisionDir = VecMinus(collisionPoint, currentPosition);
+    // exactly on the line there is no direction to push out along, and Normalize would give NaN
+    if (collisionDir.x == 0 && collisionDir.y == 0) return lastPosition;
+   
+    Vec2 n = Normalize(collisionDir);
+    float dot = Dot(dir, n);
+    n = VecMulF(n, dot);
+    dir.x -= n.x;
+    dir.y -= n.y;
+ 
+    Vec2 resolvedPos = VecPlus(lastPosition, dir);
+ 
+    return resolvedPos;
+}
+
+static void CollideWall(int w, void* userData) {
+    CollisionQuery* query = static_cast<CollisionQuery*>(userData);
+
+    LineSeg line;
+    line.p1 = level.verts[level.walls[w].v1];
+    line.p2 = level.verts[level.walls[w].v2];
+
+    query->tests++;
+    if (LineCircleCollision(line, cam.camPos, PLAYER_RADIUS)) {
+        cam.camPos = ResolveCollision(cam.oldCamPos, cam.camPos, line, query->deltaTime);
+    }
+}
+
+// Only walls in the grid cells around the move from oldCamPos to camPos can be hit.
+// The box is padded by the radius, far more than a resolved step slides sideways.
+void CollisionDetection(float deltaTime) {
+    PROFILE_SCOPE("collision");
+    CollisionQuery query;
+    query.deltaTime = deltaTime;
+    query.tests = 0;
+
+    Vec2 boxMin, boxMax;
+    boxMin.x = fminf(cam.oldCamPos.x, cam.camPos.x) - PLAYER_RADIUS;
+    boxMin.y = fminf(cam.oldCamPos.y, cam.camPos.y) - PLAYER_RADIUS;
+    boxMax.x = fmaxf(cam.oldCamPos.x, cam.camPos.x) + PLAYER_RADIUS;
+    boxMax.y = fmaxf(cam.oldCamPos.y, cam.camPos.y) + PLAYER_RADIUS;
+    QueryWallGrid(boxMin, boxMax, CollideWall, &query);
+
+    PROFILE_COUNT(COUNTER_COLLISION_TESTS, query.tests);
+}
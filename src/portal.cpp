@@ -0,0 +1,160 @@
+#include "portal.hpp"
+#include "engine.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <tuple>
+#include <vector>
+
+PortalGraph portals;
+
+typedef std::tuple<float, float, float, float> EdgeKey;
+
+static EdgeKey KeyOf(Vec2 a, Vec2 b) {
+    return EdgeKey(a.x, a.y, b.x, b.y);
+}
+
+// Signed distance of p from the line through a and b, positive on the left
+static float EdgeSide(Vec2 a, Vec2 b, Vec2 p) {
+    float len = Len(a, b);
+    if (len <= 0) return 0;
+    return Cross2dPoints(b.x - a.x, b.y - a.y, p.x - a.x, p.y - a.y) / len;
+}
+
+// Every vertex of the region has to be on the inner side of every edge
+static int RegionIsConvex(const PortalRegion* region) {
+    for (int i = 0; i < region->edgeCount; i++) {
+        const PortalEdge* edge = &portals.edges[region->firstEdge + i];
+        Vec2 a = level.verts[edge->v1], b = level.verts[edge->v2];
+        for (int j = 0; j < region->edgeCount; j++) {
+            Vec2 p = level.verts[portals.edges[region->firstEdge + j].v2];
+            if (EdgeSide(a, b, p) < -PORTAL_EPSILON) return 0;
+        }
+    }
+    return 1;
+}
+
+static int RegionContains(int region, Vec2 pos) {
+    const PortalRegion* r = &portals.regions[region];
+    for (int i = 0; i < r->edgeCount; i++) {
+        const PortalEdge* edge = &portals.edges[r->firstEdge + i];
+        if (EdgeSide(level.verts[edge->v1], level.verts[edge->v2], pos) < -PORTAL_EPSILON) return 0;
+    }
+    return 1;
+}
+
+int BuildPortals() {
+    FreePortals();
+    if (level.sectorCount == 0) return 0;
+
+    int sectorCount = level.sectorCount;
+    int regionCount = sectorCount + level.polyCount;
+    int edgeCount = level.sectorEdgeCount + level.wallCount;
+    portals.regions = static_cast<PortalRegion*>(malloc(regionCount * sizeof(PortalRegion)));
+    portals.edges = static_cast<PortalEdge*>(malloc(edgeCount * sizeof(PortalEdge)));
+    portals.sectorCount = sectorCount;
+    portals.regionCount = regionCount;
+    portals.edgeCount = edgeCount;
+
+    // walls look into the sector that lists them, the others touch another polygon or nothing
+    std::vector<int> sectorOfWall(level.wallCount, -1);
+    for (int s = 0; s < sectorCount; s++) {
+        const LevelSector* sector = &level.sectors[s];
+        portals.regions[s].firstEdge = sector->firstEdge;
+        portals.regions[s].edgeCount = sector->edgeCount;
+
+        for (Uint32 i = 0; i < sector->edgeCount; i++) {
+            const LevelSectorEdge* src = &level.sectorEdges[sector->firstEdge + i];
+            PortalEdge* edge = &portals.edges[sector->firstEdge + i];
+            edge->v1 = src->v1;
+            edge->v2 = src->v2;
+            if (src->wall != LEVEL_NONE) {
+                edge->wall = src->wall;
+                edge->neighbor = sectorCount + level.walls[src->wall].poly;
+                sectorOfWall[src->wall] = s;
+            } else {
+                edge->wall = -1;
+                edge->neighbor = src->sector;
+            }
+        }
+    }
+
+    std::map<EdgeKey, int> wallByEnds;
+    for (int w = 0; w < level.wallCount; w++) {
+        wallByEnds[KeyOf(level.verts[level.walls[w].v1], level.verts[level.walls[w].v2])] = w;
+    }
+
+    int firstPolyEdge = level.sectorEdgeCount;
+    for (int p = 0; p < level.polyCount; p++) {
+        const LevelPoly* poly = &level.polys[p];
+        PortalRegion* region = &portals.regions[sectorCount + p];
+        region->firstEdge = firstPolyEdge + poly->firstWall;
+        region->edgeCount = poly->wallCount;
+
+        for (Uint32 i = 0; i < poly->wallCount; i++) {
+            int w = poly->firstWall + i;
+            PortalEdge* edge = &portals.edges[region->firstEdge + i];
+            edge->v1 = level.walls[w].v1;
+            edge->v2 = level.walls[w].v2;
+            edge->wall = -1;
+            edge->neighbor = -1;
+
+            if (sectorOfWall[w] >= 0) {
+                edge->neighbor = sectorOfWall[w];
+            } else {
+                // polygons that touch share a wall running the other way, which shows when the
+                // polygon on this side is the lower one
+                auto twin = wallByEnds.find(KeyOf(level.verts[edge->v2], level.verts[edge->v1]));
+                if (twin != wallByEnds.end()) {
+                    edge->wall = twin->second;
+                    edge->neighbor = sectorCount + level.walls[twin->second].poly;
+                }
+            }
+        }
+    }
+
+    for (int r = 0; r < regionCount; r++) {
+        if (!RegionIsConvex(&portals.regions[r])) {
+            if (r < sectorCount) printf("Sector %d is not convex and counter-clockwise, drawing through the BSP\n", r);
+            else printf("Polygon %d is not convex, drawing through the BSP\n", r - sectorCount);
+            FreePortals();
+            return 0;
+        }
+    }
+
+    portals.lastSector = 0;
+    return 1;
+}
+
+void FreePortals() {
+    free(portals.regions);
+    free(portals.edges);
+    memset(&portals, 0, sizeof(portals));
+}
+
+int LocateSector(Vec2 pos) {
+    if (portals.sectorCount == 0) return -1;
+
+    int last = portals.lastSector;
+    if (RegionContains(last, pos)) return last;
+
+    const PortalRegion* region = &portals.regions[last];
+    for (int i = 0; i < region->edgeCount; i++) {
+        const PortalEdge* edge = &portals.edges[region->firstEdge + i];
+        if (edge->wall < 0 && edge->neighbor >= 0 && RegionContains(edge->neighbor, pos)) {
+            portals.lastSector = edge->neighbor;
+            return edge->neighbor;
+        }
+    }
+
+    for (int s = 0; s < portals.sectorCount; s++) {
+        if (RegionContains(s, pos)) {
+            portals.lastSector = s;
+            return s;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// Region graph for levels that come with sectors. The open space is split into
+// convex sectors and every polygon is a convex region of its own, edges lead to
+// the region on their other side. The renderer starts in the sector holding the
+// camera and only follows the edges it looks out through, so the work per frame
+// depends on what can be seen and not on the size of the level. Going through a
+// wall into its polygon and out the far side is how a taller wall behind a lower
+// one stays visible above it.
+
+#define PORTAL_EPSILON 0.001f // how far outside a sector a point still counts as inside
+
+typedef struct {
+    int v1, v2;   // vertex pool indices, the region is on the left going from v1 to v2
+    int wall;     // wall of the region behind that faces this one, drawn when looking out, -1 for none
+    int neighbor; // region on the other side, -1 for the outside of the level
+} PortalEdge;
+
+typedef struct {
+    int firstEdge, edgeCount;
+} PortalRegion;
+
+typedef struct {
+    PortalRegion* regions; // the sectors, then one per polygon
+    PortalEdge* edges;
+    int sectorCount, regionCount, edgeCount;
+    int lastSector; // where the camera was found the last time
+} PortalGraph;
+
+extern PortalGraph portals;
+
+// Returns 0 when the level has no sectors or they cannot be used, the renderer
+// then walks the BSP instead. Needs the level loaded.
+int BuildPortals();
+void FreePortals();
+
+// Sector holding the point or -1. Starts from the previous answer and its
+// neighbours, which is where a moving camera almost always is.
+int LocateSector(Vec2 pos);
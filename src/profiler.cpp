@@ -0,0 +1,256 @@
+#ifdef DOOM_PROFILE
+
+#include "profiler.hpp"
+#include "engine.hpp"
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <ctype.h>
+#include <stdio.h>
+
+#define HUD_MAX_STAGES 16
+
+typedef struct {
+    const char* name;
+    Uint64 start, end;
+    Uint32 frame;
+    int threadId;
+    int depth;
+} ProfileEvent;
+
+typedef struct {
+    Uint64 start, end;
+    Uint32 frame;
+    Sint64 counters[COUNTER_COUNT];
+} ProfileFrameRecord;
+
+typedef struct {
+    const char* name;
+    double ms;
+} HudStage;
+
+static const char* counterNames[COUNTER_COUNT] = { "visibleWalls", "pixelsFilled", "collisionTests", "bspNodes", "arenaBytes", "renderWidth", "sectorsVisited", "wallsVisited", "spritesVisible" };
+static const char* counterLabels[COUNTER_COUNT] = { "WALLS", "PIXELS", "COLLISION TESTS", "BSP NODES", "ARENA BYTES", "RENDER WIDTH", "SECTORS VISITED", "WALLS VISITED", "SPRITES" };
+
+static ProfileEvent events[PROFILE_MAX_EVENTS];
+static std::atomic<Uint32> eventHead(0);
+
+static ProfileFrameRecord frames[PROFILE_MAX_FRAMES];
+static std::atomic<Uint32> curFrame(0);
+static std::atomic<Sint64> counters[COUNTER_COUNT];
+
+static std::atomic<int> nextThreadId(0);
+static thread_local int threadId = -1;
+static thread_local int scopeDepth = 0;
+static int mainThreadId = -1;
+static int frameOpen = 0;
+
+static int hudVisible = 0;
+static HudStage hudStages[HUD_MAX_STAGES];
+static int hudStageCount;
+static double hudFrameMs;
+static Sint64 hudCounters[COUNTER_COUNT];
+
+static int ThreadId() {
+    if (threadId < 0) threadId = nextThreadId.fetch_add(1);
+    return threadId;
+}
+
+Uint64 ProfileTicks() {
+    return SDL_GetPerformanceCounter();
+}
+
+int ProfileEnterScope() {
+    return scopeDepth++;
+}
+
+void ProfileRecord(const char* name, Uint64 start, Uint64 end, int depth) {
+    scopeDepth = depth;
+
+    Uint32 idx = eventHead.fetch_add(1, std::memory_order_relaxed) & (PROFILE_MAX_EVENTS - 1);
+    ProfileEvent* ev = &events[idx];
+    ev->name = name;
+    ev->start = start;
+    ev->end = end;
+    ev->frame = curFrame.load(std::memory_order_relaxed);
+    ev->threadId = ThreadId();
+    ev->depth = depth;
+}
+
+void ProfileCount(int counter, Sint64 amount) {
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// Sums the top level scopes the main thread recorded during a frame
+static void UpdateHud(Uint32 frame) {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    Uint32 head = eventHead.load(std::memory_order_relaxed);
+
+    hudStageCount = 0;
+    for (Uint32 n = 0; n < PROFILE_MAX_EVENTS && n < head; n++) {
+        const ProfileEvent* ev = &events[(head - 1 - n) & (PROFILE_MAX_EVENTS - 1)];
+        if (ev->frame != frame) {
+            if (ev->frame < frame) break;
+            continue;
+        }
+        if (ev->threadId != mainThreadId || ev->depth != 0) continue;
+
+        int s = 0;
+        while (s < hudStageCount && hudStages[s].name != ev->name) s++;
+        if (s == hudStageCount) {
+            if (hudStageCount == HUD_MAX_STAGES) continue;
+            hudStages[hudStageCount].name = ev->name;
+            hudStages[hudStageCount].ms = 0;
+            hudStageCount++;
+        }
+        hudStages[s].ms += (ev->end - ev->start) * toMs;
+    }
+
+    // the scan ran newest first, list the stages in the order they ran
+    for (int a = 0, b = hudStageCount - 1; a < b; a++, b--) {
+        HudStage t = hudStages[a];
+        hudStages[a] = hudStages[b];
+        hudStages[b] = t;
+    }
+
+    const ProfileFrameRecord* rec = &frames[frame % PROFILE_MAX_FRAMES];
+    hudFrameMs = (rec->end - rec->start) * toMs;
+    for (int c = 0; c < COUNTER_COUNT; c++) hudCounters[c] = rec->counters[c];
+}
+
+void ProfileFrame() {
+    Uint64 now = ProfileTicks();
+    mainThreadId = ThreadId();
+
+    Uint32 frame = curFrame.load(std::memory_order_relaxed);
+    if (frameOpen) {
+        ProfileFrameRecord* rec = &frames[frame % PROFILE_MAX_FRAMES];
+        rec->end = now;
+        for (int c = 0; c < COUNTER_COUNT; c++) rec->counters[c] = counters[c].exchange(0);
+        if (hudVisible) UpdateHud(frame);
+        frame++;
+    }
+
+    ProfileFrameRecord* rec = &frames[frame % PROFILE_MAX_FRAMES];
+    rec->frame = frame;
+    rec->start = now;
+    rec->end = now;
+    curFrame.store(frame, std::memory_order_relaxed);
+    frameOpen = 1;
+}
+
+int ProfileWriteTrace(const char* fileName, int frameCount) {
+    FILE* out = fopen(fileName, "w");
+    if (!out) return 0;
+
+    double toUs = 1000000.0 / SDL_GetPerformanceFrequency();
+    Uint32 frame = curFrame.load(std::memory_order_relaxed);
+    Uint32 firstFrame = frame > static_cast<Uint32>(frameCount) ? frame - frameCount : 0;
+    if (frame - firstFrame >= PROFILE_MAX_FRAMES) firstFrame = frame - PROFILE_MAX_FRAMES + 1;
+    Uint64 origin = frames[firstFrame % PROFILE_MAX_FRAMES].start;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    int first = 1;
+
+    for (Uint32 f = firstFrame; f < frame; f++) {
+        const ProfileFrameRecord* rec = &frames[f % PROFILE_MAX_FRAMES];
+        fprintf(out, "%s{\"name\":\"frame %u\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",\n", f, mainThreadId, (rec->start - origin) * toUs, (rec->end - rec->start) * toUs);
+        fprintf(out, ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{", (rec->start - origin) * toUs);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            fprintf(out, "%s\"%s\":%lld", c ? "," : "", counterNames[c], static_cast<long long>(rec->counters[c]));
+        }
+        fprintf(out, "}}");
+        first = 0;
+    }
+
+    Uint32 head = eventHead.load(std::memory_order_relaxed);
+    Uint32 count = head < PROFILE_MAX_EVENTS ? head : PROFILE_MAX_EVENTS;
+    for (Uint32 n = count; n > 0; n--) {
+        const ProfileEvent* ev = &events[(head - n) & (PROFILE_MAX_EVENTS - 1)];
+        if (ev->frame < firstFrame || ev->frame >= frame) continue;
+
+        fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            first ? "" : ",\n", ev->name, ev->threadId, (ev->start - origin) * toUs, (ev->end - ev->start) * toUs);
+        first = 0;
+    }
+
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    return 1;
+}
+
+void ProfileToggleHud() {
+    hudVisible = !hudVisible;
+}
+
+// 3x5 glyphs, one row per byte, most significant of the three bits is the left pixel
+static const char fontChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-/";
+static const Uint8 fontGlyphs[][5] = {
+    {7,5,5,5,7}, {2,6,2,2,7}, {7,1,7,4,7}, {7,1,7,1,7}, {5,5,7,1,1},
+    {7,4,7,1,7}, {7,4,7,5,7}, {7,1,1,1,1}, {7,5,7,5,7}, {7,5,7,1,7},
+    {2,5,7,5,5}, {6,5,6,5,6}, {3,4,4,4,3}, {6,5,5,5,6}, {7,4,6,4,7},
+    {7,4,6,4,4}, {3,4,5,5,3}, {5,5,7,5,5}, {7,2,2,2,7}, {1,1,1,5,2},
+    {5,5,6,5,5}, {4,4,4,4,7}, {5,7,7,5,5}, {6,5,5,5,5}, {2,5,5,5,2},
+    {6,5,6,4,4}, {2,5,5,6,3}, {6,5,6,5,5}, {3,4,2,1,6}, {7,2,2,2,2},
+    {5,5,5,5,7}, {5,5,5,5,2}, {5,5,7,7,5}, {5,5,2,5,5}, {5,5,2,2,2},
+    {7,1,2,4,7}, {0,0,0,0,2}, {0,2,0,2,0}, {0,0,7,0,0}, {1,1,2,4,4},
+};
+
+static void DrawText(int x, int y, const char* text, Uint32 color) {
+    for (; *text; text++, x += 4) {
+        const char* ch = fontChars;
+        char c = toupper(*text);
+        while (*ch && *ch != c) ch++;
+        if (!*ch) continue;
+
+        const Uint8* glyph = fontGlyphs[ch - fontChars];
+        for (int gy = 0; gy < 5; gy++) {
+            for (int gx = 0; gx < 3; gx++) {
+                if (glyph[gy] & (4 >> gx)) PutPixel(x + gx, y + gy, color >> 16, color >> 8, color);
+            }
+        }
+    }
+}
+
+static void DimRect(int x0, int y0, int x1, int y1) {
+    if (x1 > screenW) x1 = screenW;
+    if (y1 > screenH) y1 = screenH;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            Uint32* p = &frameBuffer[y * screenW + x];
+            *p = 0xFF000000 | ((*p >> 2) & 0x3F3F3F);
+        }
+    }
+}
+
+void ProfileDrawHud() {
+    if (!hudVisible) return;
+
+    const int lineH = 7, barX = 100, barMaxW = 120;
+    int lines = 1 + hudStageCount + COUNTER_COUNT;
+    DimRect(0, 0, barX + barMaxW + 4, 4 + lines * lineH);
+
+    char text[64];
+    int y = 2;
+    snprintf(text, sizeof(text), "FRAME %.2f MS", hudFrameMs);
+    DrawText(2, y, text, 0xFFFFFF);
+    y += lineH;
+
+    for (int s = 0; s < hudStageCount; s++) {
+        snprintf(text, sizeof(text), "%s %.2f", hudStages[s].name, hudStages[s].ms);
+        DrawText(2, y, text, 0xFFFF40);
+
+        int barW = hudFrameMs > 0 ? static_cast<int>(barMaxW * hudStages[s].ms / hudFrameMs) : 0;
+        for (int by = y; by < y + 5; by++) FillRow(by, barX, barX + barW, 0xFFFFA000);
+        y += lineH;
+    }
+
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        snprintf(text, sizeof(text), "%s %lld", counterLabels[c], static_cast<long long>(hudCounters[c]));
+        DrawText(2, y, text, 0xFF80FF80);
+        y += lineH;
+    }
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+// Frame profiler: scoped timers on the high resolution counter, per frame
+// counters, a ring buffer of the last frames that can be dumped as a Chrome
+// trace_event file, and a stage breakdown overlay drawn into the framebuffer.
+// Without DOOM_PROFILE every macro expands to nothing.
+
+enum {
+    COUNTER_VISIBLE_WALLS,
+    COUNTER_PIXELS_FILLED,
+    COUNTER_COLLISION_TESTS,
+    COUNTER_BSP_NODES,
+    COUNTER_ARENA_BYTES,
+    COUNTER_RENDER_WIDTH,
+    COUNTER_SECTORS_VISITED,
+    COUNTER_WALLS_VISITED,
+    COUNTER_SPRITES_VISIBLE,
+    COUNTER_COUNT
+};
+
+#ifdef DOOM_PROFILE
+
+#include <SDL2/SDL_stdinc.h>
+
+#define PROFILE_MAX_EVENTS 65536 // power of two
+#define PROFILE_MAX_FRAMES 256
+#define PROFILE_TRACE_FRAMES 120 // frames written per trace dump
+#define PROFILE_TRACE_KEY SDLK_F2
+#define PROFILE_HUD_KEY SDLK_F3
+
+void ProfileRecord(const char* name, Uint64 start, Uint64 end, int depth);
+void ProfileCount(int counter, Sint64 amount);
+void ProfileFrame();
+int ProfileWriteTrace(const char* fileName, int frameCount);
+void ProfileToggleHud();
+void ProfileDrawHud();
+
+Uint64 ProfileTicks();
+int ProfileEnterScope();
+
+class ProfileScope {
+public:
+    ProfileScope(const char* name) : name(name), depth(ProfileEnterScope()), start(ProfileTicks()) {}
+    ~ProfileScope() { ProfileRecord(name, start, ProfileTicks(), depth); }
+
+private:
+    const char* name;
+    int depth;
+    Uint64 start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) ProfileCount(counter, amount)
+#define PROFILE_FRAME() ProfileFrame()
+#define PROFILE_DRAW_HUD() ProfileDrawHud()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(counter, amount) ((void)sizeof(amount))
+#define PROFILE_FRAME()
+#define PROFILE_DRAW_HUD()
+
+#endif
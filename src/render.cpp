@@ -0,0 +1,1029 @@
+#include "assets.hpp"
+#include "bsp.hpp"
+#include "engine.hpp"
+#include "fixed.hpp"
+#include "jobs.hpp"
+#include "palette.hpp"
+#include "portal.hpp"
+#include "profiler.hpp"
+#include "sprite.hpp"
+#include "transform.hpp"
+
+#include <math.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The frame is drawn as palette indices and expanded into the framebuffer, which
+// is uploaded to the screen once per frame. Overlays like the profiler HUD draw
+// straight into the framebuffer after the expansion.
+alignas(64) Uint8 indexBuffer[WINDOW_W * WINDOW_H];
+alignas(64) Uint32 frameBuffer[WINDOW_W * WINDOW_H];
+
+Camera viewCam;
+
+int screenW = WINDOW_W / RES_DIV;
+int screenH = WINDOW_H / RES_DIV;
+
+// Screen heights scale with the render resolution, 1 at WINDOW_H / RES_DIV where the
+// projection constants were tuned, so walls keep their proportions at every size
+static float heightScale = 1.0f;
+
+Texture wallTexture;
+int wallTextureAsset = -1;
+int texturedWalls = 1;
+int renderPipeline = DEFAULT_RENDER_PIPELINE;
+
+// What this frame draws with, picked by BeginFrame()
+static const RenderPipeline* framePipeline;
+static const RenderPipeline* PipelineFor(int fill, int shade, int stride);
+static const Texture* frameWallTexture; // taken from the cache once per frame
+
+// Everything below is allocated from here and only lives for one frame
+Arena frameArena;
+
+// Open [top, bottom) rows of every column, written by the raster bands. Walls are
+// drawn nearest first and only fill what is still open. Every wall stands on the
+// floor, so nothing farther away can show below the top edge of a nearer wall and
+// drawing a wall moves the bottom of the range up to its top.
+static Sint16* clipTop;
+static Sint16* clipBottom;
+
+// Wall depths for clipping sprites, only kept in frames that have sprites in view.
+// Every wall a column shows moves its clip bottom up, nearest first, so a column
+// is a stack of layers from the bottom up, each with the 1 / z of its wall and
+// the row its top reached. A sprite is hidden below the top of the last layer
+// nearer than it. A column with more layers than fit keeps raising its last one,
+// which can only hide more of a sprite, never show it through a wall.
+#define DEPTH_LAYERS 16
+static float* layerInvZ; // DEPTH_LAYERS per column
+static Sint16* layerTop;
+static Uint8* layerCount;
+
+// Sprites in view on the screen, farthest first, and the ones every raster band
+// overlaps as indices into that list, still farthest first
+typedef struct {
+    float left, right, top, bottom; // not clipped to the screen
+    float invZ;
+    const SpriteImage* image;
+    const Uint8* colormap;
+} ScreenSprite;
+static ScreenSprite* screenSprites;
+static int screenSpriteCount;
+static int* bandSpriteStart; // band b has [bandSpriteStart[b], bandSpriteStart[b + 1])
+static int* bandSprites;
+
+// Columns some wall already covers up to the top of the screen, filled while
+// projecting so the traversal can stop once the whole screen is solid. Columns
+// the wall also covers down to the bottom need no background at all.
+#define COLUMN_SOLID 1
+#define COLUMN_COVERED 2
+static Uint8* solidColumns;
+static int solidColumnCount;
+
+int screenSpaceVisiblePlanes;
+ScreenSpacePoly* screenSpacePolys; // one entry per visible seg, nearest first in every column
+static int screenSpaceCapacity;
+VisibilityStats visibility;
+
+// Columns the next projected wall may fill, all of them unless a portal narrowed it
+static int windowStart, windowEnd;
+
+// Regions waiting to be visited by the portal traversal, the memory is kept between frames
+typedef struct {
+    int region;
+    int from;   // region it was seen from
+    int x0, x1; // columns it is seen through
+} RegionVisit;
+static RegionVisit* regionStack;
+static int regionStackCapacity;
+
+// Sky and ground are drawn once per resolution into one column taller than the
+// screen, with the horizon at backgroundHorizon. Bobbing only moves the horizon, so
+// a frame copies its rows from backgroundOffset on.
+static Uint8 backgroundRows[WINDOW_H * 2];
+static int backgroundHorizon;
+static int backgroundOffset;
+
+static Uint8 flatWallColor;
+static Uint8 wireInteriorColor; // walls are black inside their outline in wireframe
+
+#define INV_Z_BITS 27 // fixed point 1 / z is 5.27, z never gets below the near plane at 0.1
+
+Uint32 PackColor(Uint8 r, Uint8 g, Uint8 b) {
+    return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+void PutPixel(int x, int y, Uint8 r, Uint8 g, Uint8 b) {
+    if (x >= screenW || y >= screenH) return;
+    if (x < 0 || y < 0) return;
+    frameBuffer[y * screenW + x] = PackColor(r, g, b);
+}
+
+void FillRow(int y, int x0, int x1, Uint32 color) {
+    Uint32* row = &frameBuffer[y * screenW];
+    for (int x = x0; x < x1; x++) row[x] = color;
+}
+
+int IsFrontFace(Vec2 Camera, Vec2 pointA, Vec2 pointB) {
+    const int RIGHT = 1, LEFT = -1, ZERO = 0;
+#ifdef DOOM_FIXED_POINT
+    // exact in 64 bits, where the float version truncates the cross product to an int
+    Sint64 ax = FloatToFixed(pointA.x - Camera.x), ay = FloatToFixed(pointA.y - Camera.y);
+    Sint64 bx = FloatToFixed(pointB.x - Camera.x), by = FloatToFixed(pointB.y - Camera.y);
+    Sint64 cross = ax * by - ay * bx;
+    if (cross > 0) return RIGHT;
+    if (cross < 0) return LEFT;
+    return ZERO;
+#else
+    pointA.x -= Camera.x;
+    pointA.y -= Camera.y;
+    pointB.x -= Camera.x;
+    pointB.y -= Camera.y;
+    int cross_product = pointA.x * pointB.y - pointA.y * pointB.x;
+    
+    if (cross_product > 0) return RIGHT;
+    if (cross_product < 0) return LEFT;
+    
+    return ZERO;
+#endif
+}
+
+// nvert = vertices count
+// vertx = all x vertices coordinates
+// verty = all y vertices coordinates
+// testx & testy = point to test if inside the polygon
+int PointInPoly(int nvert, float *vertx, float *verty, float testx, float testy) {
+    int i, j, isPointInside = 0;
+ 
+    for (i = 0, j = nvert - 1; i < nvert; j = i++) {
+        int isSameCoordinates = 0;
+        
+        if ((verty[i]>testy) == (verty[j]>testy)) isSameCoordinates = 1;
+ 
+        if (isSameCoordinates == 0 && (testx < (vertx[j]-vertx[i]) * (testy - verty[i]) / (verty[j]-verty[i]) + vertx[i])) {
+            isPointInside = !isPointInside;
+        }
+    }
+    
+    return isPointInside;
+}
+
+void DrawColumn(Uint8* dst, int pitch, int count, Uint8 color) {
+    for (int i = 0; i < count; i++) dst[i * pitch] = color;
+}
+
+// Walks one texture column from the top of the span down, v is 16.16 texels above
+// the bottom of the wall at mip 0 and shift picks the mip on top of the 16 bits.
+// Unshaded columns copy the texels as they are.
+template <int Shade>
+static inline void DrawTexturedSpan(Uint8* dst, int pitch, int count, const Uint8* texels, int mask, int shift, Sint32 v, Sint32 vStep, const Uint8* colormap) {
+    for (int i = 0; i < count; i++) {
+        Uint8 texel = texels[(v >> shift) & mask];
+        if constexpr (Shade == SHADE_DISTANCE) dst[i * pitch] = colormap[texel];
+        else dst[i * pitch] = texel;
+        v -= vStep;
+    }
+}
+
+void DrawTexturedColumn(Uint8* dst, int pitch, int count, const Uint8* texels, int mask, int shift, Sint32 v, Sint32 vStep, const Uint8* colormap) {
+    DrawTexturedSpan<SHADE_DISTANCE>(dst, pitch, count, texels, mask, shift, v, vStep, colormap);
+}
+
+// Copies the background into columns [x0, x1), leaving out the columns at either
+// end that walls cover completely
+static void DrawBackground(int x0, int x1) {
+    while (x0 < x1 && solidColumns[x0] == COLUMN_COVERED) x0++;
+    while (x1 > x0 && solidColumns[x1 - 1] == COLUMN_COVERED) x1--;
+    if (x0 == x1) return;
+
+    const Uint8* rows = &backgroundRows[backgroundOffset];
+    for (int y = 0; y < screenH; y++) memset(&indexBuffer[y * screenW + x0], rows[y], x1 - x0);
+}
+
+static float WaveOffset() {
+#ifdef DOOM_FIXED_POINT
+    return WWAVE_MAG * heightScale * FixedToFloat(FixedSin(AngleFromRadians(viewCam.stepWave)));
+#else
+    return WWAVE_MAG * heightScale * sinf(viewCam.stepWave);
+#endif
+}
+
+static void BuildBackground() {
+    int margin = static_cast<int>(ceilf(WWAVE_MAG * heightScale)) + 2;
+    backgroundHorizon = screenH / 2 + margin;
+
+    // without bobbing the horizon is at screenH / 2 and the ground darkens towards it
+    Uint8 skyColor = NearestColor(77, 181, 255);
+    for (int r = 0; r < screenH + margin * 2; r++) {
+        int y = static_cast<int>((r - backgroundHorizon + screenH / 2) / heightScale);
+        backgroundRows[r] = r < backgroundHorizon ? skyColor : NearestColor(y / 2, y / 2, y / 2);
+    }
+}
+
+// Needs the palette, Init() builds it first
+void AllocRenderBuffers() {
+    ArenaInit(&frameArena, FRAME_ARENA_SIZE);
+    flatWallColor = NearestColor(0, 255, 0);
+    wireInteriorColor = NearestColor(0, 0, 0);
+    BuildBackground();
+}
+
+// Takes effect with the next frame, the clip and occlusion arrays come from the
+// frame arena so only the background depends on the size
+void SetRenderResolution(int width, int height) {
+    screenW = width < WINDOW_W ? width : WINDOW_W;
+    screenH = height < WINDOW_H ? height : WINDOW_H;
+    heightScale = static_cast<float>(screenH) / (WINDOW_H / RES_DIV);
+    BuildBackground();
+}
+
+void FreeRenderBuffers() {
+    ArenaFree(&frameArena);
+    free(regionStack);
+    regionStack = NULL;
+    regionStackCapacity = 0;
+    screenSpacePolys = NULL;
+    screenSpaceVisiblePlanes = 0;
+    screenSpaceCapacity = 0;
+}
+
+// Drops the last frame's transient data, the arena memory itself is kept
+void BeginFrame() {
+    PumpAssets();
+
+    // turning the texture off keeps the shading and stride of the pipeline
+    int pipeline = renderPipeline >= 0 && renderPipeline < renderPipelineCount ? renderPipeline : DEFAULT_RENDER_PIPELINE;
+    framePipeline = &renderPipelines[pipeline];
+    if (framePipeline->fill == FILL_TEXTURED && !texturedWalls) framePipeline = PipelineFor(FILL_FLAT, framePipeline->shade, framePipeline->stride);
+
+    ArenaReset(&frameArena);
+    screenSpacePolys = NULL;
+    screenSpaceVisiblePlanes = 0;
+    screenSpaceCapacity = 0;
+    screenSpriteCount = 0;
+}
+
+// vert[1]/vert[2] are the top/bottom of one vertical edge and vert[0]/vert[3] of
+// the other, returns them ordered left to right. Returns the index of the left edge
+// in invZ and uOverZ.
+static int WallEdges(const ScreenSpacePoly* wall, Vec2* leftTop, Vec2* leftBottom, Vec2* rightTop, Vec2* rightBottom) {
+    *leftTop = wall->vert[1];
+    *leftBottom = wall->vert[2];
+    *rightTop = wall->vert[0];
+    *rightBottom = wall->vert[3];
+    if (leftTop->x > rightTop->x) {
+        Vec2 t = *leftTop; *leftTop = *rightTop; *rightTop = t;
+        t = *leftBottom; *leftBottom = *rightBottom; *rightBottom = t;
+        return 1;
+    }
+    return 0;
+}
+
+static void RecordDepthLayer(int x, float invZ, int top) {
+    int n = layerCount[x];
+    Sint16* tops = &layerTop[x * DEPTH_LAYERS];
+    if (n == DEPTH_LAYERS) {
+        tops[n - 1] = top;
+        return;
+    }
+    layerInvZ[x * DEPTH_LAYERS + n] = invZ;
+    tops[n] = top;
+    layerCount[x] = n + 1;
+}
+
+// Fills the part of one wall trapezoid that lies in columns [bandStart, bandEnd) and
+// is still open, the top and bottom y of every column is stepped incrementally.
+// Flat walls get one color. Textured walls step 1/z and u/z across the screen and
+// every column picks the mip that keeps it near one texel per pixel. Wireframe walls
+// are the flat color around the outline and black inside, still hiding what is
+// behind them. Stride columns share the span computed for the first one. Every
+// combination is compiled on its own, so the column loops test nothing but the
+// clip ranges. Returns how many columns the wall closed.
+template <int Fill, int Shade, int Stride>
+static int RasterizeWallAs(const ScreenSpacePoly* wall, const Texture* texture, Uint8 color, const Uint8* colormap, int bandStart, int bandEnd) {
+    Vec2 leftTop, leftBottom, rightTop, rightBottom;
+    int left = WallEdges(wall, &leftTop, &leftBottom, &rightTop, &rightBottom);
+
+    float width = rightTop.x - leftTop.x;
+    if (width <= 0) return 0;
+
+    int startx = static_cast<int>(ceilf(leftTop.x));
+    int endx = static_cast<int>(ceilf(rightTop.x));
+    int firstColumn = startx, lastColumn = endx - 1; // of the whole wall, for the wireframe outline
+    if (startx < 0) startx = 0;
+    if (endx > bandEnd) endx = bandEnd;
+
+    // the column groups are aligned to the wall and not the band so every band
+    // split gives the same image
+    int x = startx;
+    if (x < bandStart) x = startx + (bandStart - startx) / Stride * Stride;
+    if (x >= endx) return 0;
+
+    float topStep = (rightTop.y - leftTop.y) / width;
+    float bottomStep = (rightBottom.y - leftBottom.y) / width;
+    float top = leftTop.y + (x - leftTop.x) * topStep;
+    float bottom = leftBottom.y + (x - leftTop.x) * bottomStep;
+    int filled = 0, closed = 0;
+
+    float invZStep = (wall->invZ[1 - left] - wall->invZ[left]) / width;
+    float uOverZStep = (wall->uOverZ[1 - left] - wall->uOverZ[left]) / width;
+    float vScale = TEXELS_PER_UNIT / (screenW / 2.0f); // texels per pixel at z = 1, same as horizontally
+    Uint8 shaded = Shade == SHADE_DISTANCE ? colormap[color] : color;
+
+    for (; x < endx; x += Stride) {
+        int starty = static_cast<int>(ceilf(top));
+        int endy = static_cast<int>(ceilf(bottom));
+
+        int firstx = x < bandStart ? bandStart : x;
+        int lastx = x + Stride < endx ? x + Stride : endx;
+        for (int cx = firstx; cx < lastx; cx++) {
+            int openTop = clipTop[cx], openBottom = clipBottom[cx];
+            if (openTop >= openBottom) continue;
+
+            int y0 = starty > openTop ? starty : openTop;
+            int y1 = endy < openBottom ? endy : openBottom;
+            if constexpr (Fill == FILL_TEXTURED) {
+                if (y1 > y0) {
+                    float dx = cx - leftTop.x;
+#ifdef DOOM_FIXED_POINT
+                    // the per column divide comes from the reciprocal table
+                    Sint64 invZ = static_cast<Sint64>((wall->invZ[left] + dx * invZStep) * (1 << INV_Z_BITS));
+                    float z = FixedWideToFloat(Reciprocal(invZ > 0 ? static_cast<Uint32>(invZ) : 1, FRACBITS + INV_Z_BITS));
+#else
+                    float z = 1.0f / (wall->invZ[left] + dx * invZStep);
+#endif
+                    float u = (wall->uOverZ[left] + dx * uOverZStep) * z;
+                    float vStep = z * vScale;
+                    float uStep = fabsf((uOverZStep - u * invZStep) * z);
+
+                    float texelsPerPixel = vStep > uStep ? vStep : uStep;
+                    int mip = 0;
+                    while (texelsPerPixel >= 2.0f && mip < texture->mipCount - 1) {
+                        texelsPerPixel *= 0.5f;
+                        mip++;
+                    }
+                    int mipW = texture->width >> mip, mipH = texture->height >> mip;
+                    const Uint8* column = texture->mips[mip] + ((static_cast<int>(u) >> mip) & (mipW - 1)) * mipH;
+
+                    // v counts up from the bottom edge of the wall, sampled at the pixel center
+                    float v0 = (bottom - y0 - 0.5f) * vStep;
+                    Sint32 v = static_cast<Sint32>((v0 > 0 ? v0 : 0) * 65536.0f);
+                    DrawTexturedSpan<Shade>(&indexBuffer[y0 * screenW + cx], screenW, y1 - y0, column, mipH - 1, 16 + mip,
+                        v, static_cast<Sint32>(vStep * 65536.0f), colormap);
+                }
+            } else if constexpr (Fill == FILL_FLAT) {
+                if (y1 > y0) DrawColumn(&indexBuffer[y0 * screenW + cx], screenW, y1 - y0, shaded);
+            } else {
+                if (y1 > y0) {
+                    // the side edges run the whole span and are as wide as a column group, the top
+                    // and bottom ones only show where they are not clipped
+                    int side = cx < firstColumn + Stride || cx + Stride > lastColumn;
+                    DrawColumn(&indexBuffer[y0 * screenW + cx], screenW, y1 - y0, side ? shaded : wireInteriorColor);
+                    if (y0 == starty) indexBuffer[y0 * screenW + cx] = shaded;
+                    if (y1 == endy) indexBuffer[(y1 - 1) * screenW + cx] = shaded;
+                }
+            }
+            if (y1 > y0) filled += y1 - y0;
+
+            if (y0 < openBottom) {
+                clipBottom[cx] = y0;
+                closed += y0 <= openTop;
+                if (layerCount) RecordDepthLayer(cx, wall->invZ[left] + (cx - leftTop.x) * invZStep, y0);
+            }
+        }
+
+        top += topStep * Stride;
+        bottom += bottomStep * Stride;
+    }
+
+    PROFILE_COUNT(COUNTER_PIXELS_FILLED, filled);
+    return closed;
+}
+
+#define PIPELINE(fill, shade, stride, name) { name, fill, shade, stride, RasterizeWallAs<fill, shade, stride> }
+#define PIPELINE_STRIDES(fill, shade, name) \
+    PIPELINE(fill, shade, 1, name), PIPELINE(fill, shade, 2, name "_2"), PIPELINE(fill, shade, 4, name "_4")
+
+// The first one is the default
+const RenderPipeline renderPipelines[] = {
+    PIPELINE_STRIDES(FILL_TEXTURED, SHADE_DISTANCE, "textured"),
+    PIPELINE_STRIDES(FILL_TEXTURED, SHADE_NONE, "textured_unlit"),
+    PIPELINE_STRIDES(FILL_FLAT, SHADE_DISTANCE, "flat"),
+    PIPELINE_STRIDES(FILL_FLAT, SHADE_NONE, "flat_unlit"),
+    PIPELINE_STRIDES(FILL_WIREFRAME, SHADE_DISTANCE, "wireframe"),
+    PIPELINE_STRIDES(FILL_WIREFRAME, SHADE_NONE, "wireframe_unlit"),
+};
+
+const int renderPipelineCount = sizeof(renderPipelines) / sizeof(renderPipelines[0]);
+
+int FindRenderPipeline(const char* name) {
+    for (int p = 0; p < renderPipelineCount; p++) {
+        if (strcmp(renderPipelines[p].name, name) == 0) return p;
+    }
+    return -1;
+}
+
+static const RenderPipeline* PipelineFor(int fill, int shade, int stride) {
+    for (int p = 0; p < renderPipelineCount; p++) {
+        const RenderPipeline* pipeline = &renderPipelines[p];
+        if (pipeline->fill == fill && pipeline->shade == shade && pipeline->stride == stride) return pipeline;
+    }
+    return &renderPipelines[DEFAULT_RENDER_PIPELINE];
+}
+
+// Walks one sprite column from the top down, v is 16.16 image rows
+static void DrawSpriteColumn(Uint8* dst, int pitch, int count, const Uint8* texels, Sint32 v, Sint32 vStep, const Uint8* colormap) {
+    for (int i = 0; i < count; i++) {
+        dst[i * pitch] = colormap[texels[v >> 16]];
+        v += vStep;
+    }
+}
+
+// Draws the band's sprites farthest first over the finished walls, rounded like
+// the walls and sampled at pixel centers. A column of a sprite ends at the top of
+// the farthest wall in front of it.
+static void RasterizeSprites(int band, int x0, int x1) {
+    for (int i = bandSpriteStart[band]; i < bandSpriteStart[band + 1]; i++) {
+        const ScreenSprite* sprite = &screenSprites[bandSprites[i]];
+        const SpriteImage* image = sprite->image;
+        int startx = static_cast<int>(ceilf(sprite->left));
+        int endx = static_cast<int>(ceilf(sprite->right));
+        if (startx < x0) startx = x0;
+        if (endx > x1) endx = x1;
+
+        float uScale = image->width / (sprite->right - sprite->left);
+        float vScale = image->height / (sprite->bottom - sprite->top);
+        float rowsPerTexel = 1.0f / vScale;
+        Sint32 vStep = static_cast<Sint32>(vScale * 65536.0f);
+
+        for (int x = startx; x < endx; x++) {
+            int clip = screenH;
+            for (int l = 0; l < layerCount[x] && layerInvZ[x * DEPTH_LAYERS + l] > sprite->invZ; l++) clip = layerTop[x * DEPTH_LAYERS + l];
+
+            int u = static_cast<int>((x + 0.5f - sprite->left) * uScale);
+            if (u >= image->width) u = image->width - 1;
+            const Uint8* column = image->texels + u * image->height;
+
+            for (int p = image->firstPost[u]; p < image->firstPost[u + 1]; p++) {
+                const SpritePost* post = &image->posts[p];
+                int y0 = static_cast<int>(ceilf(sprite->top + post->start * rowsPerTexel));
+                int y1 = static_cast<int>(ceilf(sprite->top + post->end * rowsPerTexel));
+                if (y0 < 0) y0 = 0;
+                if (y1 > clip) y1 = clip;
+                if (y0 >= y1) continue;
+
+                Sint32 v = static_cast<Sint32>((y0 + 0.5f - sprite->top) * vScale * 65536.0f);
+                if (v < post->start << 16) v = post->start << 16;
+                // rounding must not carry the last pixel past the post
+                while (y1 > y0 && (v + (y1 - y0 - 1) * vStep) >> 16 >= post->end) y1--;
+                DrawSpriteColumn(&indexBuffer[y0 * screenW + x], screenW, y1 - y0, column, v, vStep, sprite->colormap);
+            }
+        }
+    }
+}
+
+// Job body, a band only ever touches its own columns of the framebuffer and the
+// clip ranges so bands need no synchronization
+void RasterizeBand(int band, void* userData) {
+    PROFILE_SCOPE("band");
+    int x0 = band * RENDER_BAND_WIDTH;
+    int x1 = x0 + RENDER_BAND_WIDTH < screenW ? x0 + RENDER_BAND_WIDTH : screenW;
+
+    DrawBackground(x0, x1);
+
+    for (int x = x0; x < x1; x++) {
+        clipTop[x] = 0;
+        clipBottom[x] = screenH;
+    }
+    if (layerCount) memset(&layerCount[x0], 0, x1 - x0);
+
+    // walls are stored nearest first, the band is done once all its columns are closed
+    int openColumns = x1 - x0;
+    for (int polyIdx = 0; polyIdx < screenSpaceVisiblePlanes && openColumns > 0; polyIdx++) {
+        const ScreenSpacePoly* wall = &screenSpacePolys[polyIdx];
+        float minx = wall->vert[0].x < wall->vert[1].x ? wall->vert[0].x : wall->vert[1].x;
+        float maxx = wall->vert[0].x < wall->vert[1].x ? wall->vert[1].x : wall->vert[0].x;
+        if (maxx <= x0 || minx >= x1) continue;
+
+        int start = wall->windowStart > x0 ? wall->windowStart : x0;
+        int end = wall->windowEnd < x1 ? wall->windowEnd : x1;
+        if (start >= end) continue;
+
+        const Uint8* colormap = ColormapByDistance(wall->distFromCamera);
+        openColumns -= framePipeline->rasterizeWall(wall, frameWallTexture, flatWallColor, colormap, start, end);
+    }
+
+    if (layerCount) RasterizeSprites(band, x0, x1);
+}
+
+void Rasterize() {
+    PROFILE_SCOPE("raster");
+    clipTop = ARENA_NEW(&frameArena, Sint16, screenW);
+    clipBottom = ARENA_NEW(&frameArena, Sint16, screenW);
+    layerInvZ = NULL;
+    layerTop = NULL;
+    layerCount = NULL;
+    if (screenSpriteCount > 0) {
+        layerInvZ = ARENA_NEW(&frameArena, float, screenW * DEPTH_LAYERS);
+        layerTop = ARENA_NEW(&frameArena, Sint16, screenW * DEPTH_LAYERS);
+        layerCount = ARENA_NEW(&frameArena, Uint8, screenW);
+    }
+    int horizon = static_cast<int>(screenH / 2.0f + WaveOffset());
+    backgroundOffset = backgroundHorizon - horizon;
+    frameWallTexture = framePipeline->fill == FILL_TEXTURED ? AcquireTexture(wallTextureAsset, &wallTexture) : NULL;
+    int bandCount = (screenW + RENDER_BAND_WIDTH - 1) / RENDER_BAND_WIDTH;
+    JobsRun(bandCount, RasterizeBand, NULL);
+
+    PROFILE_COUNT(COUNTER_ARENA_BYTES, ArenaUsed(&frameArena));
+}
+
+static void ExpandRows(int job, void* userData) {
+    int y0 = job * EXPAND_ROWS;
+    int y1 = y0 + EXPAND_ROWS < screenH ? y0 + EXPAND_ROWS : screenH;
+    palette.expand(&indexBuffer[y0 * screenW], &frameBuffer[y0 * screenW], (y1 - y0) * screenW, palette.colors);
+}
+
+// Turns the finished palette index frame into 32 bit colors for upload
+void ExpandFrame() {
+    PROFILE_SCOPE("expand");
+    JobsRun((screenH + EXPAND_ROWS - 1) / EXPAND_ROWS, ExpandRows, NULL);
+}
+
+
+// Marks the columns where the wall reaches above the top of the screen as solid, and
+// as covered if it also reaches below the bottom, and returns 0 if every column it
+// spans was solid already. The margins keep this on the safe side of the rasterizer,
+// which rounds and shares spans between column groups. A wall as tall as the tallest
+// in the level closes its columns wherever its top is: farther walls stand on the
+// same floor and are no taller, so they end lower on the screen.
+static int OccludeWall(const ScreenSpacePoly* wall, int tallest) {
+    Vec2 leftTop, leftBottom, rightTop, rightBottom;
+    WallEdges(wall, &leftTop, &leftBottom, &rightTop, &rightBottom);
+
+    float width = rightTop.x - leftTop.x;
+    if (width <= 0) return 0;
+
+    int startx = static_cast<int>(ceilf(leftTop.x));
+    int endx = static_cast<int>(ceilf(rightTop.x));
+    if (startx < wall->windowStart) startx = wall->windowStart;
+    if (endx > wall->windowEnd) endx = wall->windowEnd;
+
+    float topStep = (rightTop.y - leftTop.y) / width;
+    float bottomStep = (rightBottom.y - leftBottom.y) / width;
+    float margin = -1.0f - fabsf(topStep) * (framePipeline->stride - 1);
+    float bottomMargin = screenH + 1.0f + fabsf(bottomStep) * (framePipeline->stride - 1);
+    int visible = 0;
+
+    for (int x = startx; x < endx; x++) {
+        if (solidColumns[x]) continue;
+        visible = 1;
+        int aboveTop = leftTop.y + (x - leftTop.x) * topStep <= margin;
+        if (tallest || aboveTop) {
+            // nearer walls end lower on the screen, so they cannot uncover the bottom either
+            int covered = aboveTop && leftBottom.y + (x - leftTop.x) * bottomStep >= bottomMargin;
+            solidColumns[x] = covered ? COLUMN_COVERED : COLUMN_SOLID;
+            solidColumnCount++;
+        }
+    }
+
+    return visible;
+}
+
+// Room for one more entry at the end of screenSpacePolys. The list is the newest arena
+// allocation while projecting, so it grows in place.
+static ScreenSpacePoly* NextScreenSpacePoly() {
+    if (screenSpaceVisiblePlanes == screenSpaceCapacity) {
+        int capacity = screenSpaceCapacity > 0 ? screenSpaceCapacity * 2 : 256;
+        screenSpacePolys = static_cast<ScreenSpacePoly*>(ArenaGrow(&frameArena, screenSpacePolys,
+            screenSpaceCapacity * sizeof(ScreenSpacePoly), capacity * sizeof(ScreenSpacePoly), alignof(ScreenSpacePoly)));
+        screenSpaceCapacity = capacity;
+    }
+    return &screenSpacePolys[screenSpaceVisiblePlanes];
+}
+
+// Keeps the entry NextScreenSpacePoly() handed out if any of it can still be seen
+static void AddScreenSpacePoly(const BspSeg* seg, ScreenSpacePoly* plane) {
+    plane->planeIdInPoly = seg->wall - level.polys[seg->poly].firstWall;
+    plane->windowStart = windowStart;
+    plane->windowEnd = windowEnd;
+    if (OccludeWall(plane, level.polys[seg->poly].height >= level.maxHeight)) screenSpaceVisiblePlanes++;
+}
+
+// Screen range [lo, hi] to whole columns, rounded the way the rasterizer rounds
+// wall edges so a portal and the wall next to it meet without a gap
+static int ColumnRange(float lo, float hi, int* startx, int* endx) {
+    if (lo < 0) lo = 0;
+    if (hi > screenW) hi = screenW;
+    *startx = static_cast<int>(ceilf(lo));
+    *endx = static_cast<int>(ceilf(hi));
+    return *startx < *endx;
+}
+
+#ifdef DOOM_FIXED_POINT
+
+// The same projection in 16.16 with 64 bit intermediates. Both ends take one
+// reciprocal of z from the table and multiply by it, and the screen positions only
+// turn into floats once they are final.
+static void ProjectSeg(const BspSeg* seg) {
+    Vec2 p1 = bsp.verts[seg->v1];
+    Vec2 p2 = bsp.verts[seg->v2];
+    visibility.wallsVisited++;
+    if (IsFrontFace(viewCam.camPos, p1, p2) > 0) return;
+
+    RequireViewVertex(seg->v1);
+    RequireViewVertex(seg->v2);
+    Fixed distX1 = viewVerts.fixedViewX[seg->v1];
+    Fixed z1 = viewVerts.fixedViewZ[seg->v1];
+    Fixed distX2 = viewVerts.fixedViewX[seg->v2];
+    Fixed z2 = viewVerts.fixedViewZ[seg->v2];
+
+    Fixed u1 = FloatToFixed(seg->offset * TEXELS_PER_UNIT);
+    Fixed u2 = u1 + FloatToFixed(Len(p1, p2) * TEXELS_PER_UNIT);
+
+    const Fixed NEAR_CLIP = FRACUNIT / 10;
+    if (z1 <= NEAR_CLIP && z2 <= NEAR_CLIP) return;
+    if (z1 < NEAR_CLIP) {
+        Fixed t = FixedDiv(NEAR_CLIP - z1, z2 - z1);
+        distX1 += FixedMul(t, distX2 - distX1);
+        u1 += FixedMul(t, u2 - u1);
+        z1 = NEAR_CLIP;
+    }
+    if (z2 < NEAR_CLIP) {
+        Fixed t = FixedDiv(NEAR_CLIP - z2, z1 - z2);
+        distX2 += FixedMul(t, distX1 - distX2);
+        u2 += FixedMul(t, u1 - u2);
+        z2 = NEAR_CLIP;
+    }
+
+    Sint64 invZ1 = Reciprocal(z1, FRACBITS + INV_Z_BITS);
+    Sint64 invZ2 = Reciprocal(z2, FRACBITS + INV_Z_BITS);
+
+    Sint64 height = FloatToFixed(-level.polys[seg->poly].height / RES_DIV * heightScale);
+    Sint64 widthRatio = FloatToFixed(screenW / 2.0f);
+    Sint64 heightRatio = FloatToFixed((static_cast<float>(WINDOW_W / RES_DIV) * static_cast<float>(WINDOW_H / RES_DIV)) / 60.0f * heightScale);
+    Sint64 centerScreenW = FloatToFixed(screenW / 2.0f);
+    Sint64 centerScreenH = FloatToFixed(screenH / 2.0f + WaveOffset());
+
+    // too wide for a Fixed next to the near plane
+    Sint64 x1 = centerScreenW - ((((distX1 * invZ1) >> INV_Z_BITS) * widthRatio) >> FRACBITS);
+    Sint64 x2 = centerScreenW - ((((distX2 * invZ2) >> INV_Z_BITS) * widthRatio) >> FRACBITS);
+    Sint64 y1a = centerScreenH + (((height - heightRatio) * invZ1) >> INV_Z_BITS);
+    Sint64 y1b = centerScreenH + ((heightRatio * invZ1) >> INV_Z_BITS);
+    Sint64 y2a = centerScreenH + (((height - heightRatio) * invZ2) >> INV_Z_BITS);
+    Sint64 y2b = centerScreenH + ((heightRatio * invZ2) >> INV_Z_BITS);
+
+    ScreenSpacePoly* plane = NextScreenSpacePoly();
+    plane->vert[0].x = FixedWideToFloat(x2);
+    plane->vert[0].y = FixedWideToFloat(y2a);
+    plane->vert[1].x = FixedWideToFloat(x1);
+    plane->vert[1].y = FixedWideToFloat(y1a);
+    plane->vert[2].x = FixedWideToFloat(x1);
+    plane->vert[2].y = FixedWideToFloat(y1b);
+    plane->vert[3].x = FixedWideToFloat(x2);
+    plane->vert[3].y = FixedWideToFloat(y2b);
+
+    plane->invZ[0] = static_cast<float>(invZ1) * (1.0f / (1 << INV_Z_BITS));
+    plane->invZ[1] = static_cast<float>(invZ2) * (1.0f / (1 << INV_Z_BITS));
+    plane->uOverZ[0] = FixedWideToFloat((u1 * invZ1) >> INV_Z_BITS);
+    plane->uOverZ[1] = FixedWideToFloat((u2 * invZ2) >> INV_Z_BITS);
+
+    plane->distFromCamera = FixedWideToFloat((static_cast<Sint64>(z1) + z2) / 2);
+    AddScreenSpacePoly(seg, plane);
+}
+
+// EdgeColumns() with the arithmetic of the 16.16 ProjectSeg
+static int EdgeColumns(int v1, int v2, int* startx, int* endx) {
+    RequireViewVertex(v1);
+    RequireViewVertex(v2);
+    Fixed distX1 = viewVerts.fixedViewX[v1];
+    Fixed z1 = viewVerts.fixedViewZ[v1];
+    Fixed distX2 = viewVerts.fixedViewX[v2];
+    Fixed z2 = viewVerts.fixedViewZ[v2];
+    if (z1 <= 0 && z2 <= 0) return 0;
+
+    float lo = screenW, hi = 0;
+    const Fixed NEAR_CLIP = FRACUNIT / 10;
+    if (z1 > NEAR_CLIP || z2 > NEAR_CLIP) {
+        Fixed clipX1 = distX1, clipZ1 = z1, clipX2 = distX2, clipZ2 = z2;
+        if (clipZ1 < NEAR_CLIP) {
+            clipX1 += FixedMul(FixedDiv(NEAR_CLIP - clipZ1, clipZ2 - clipZ1), clipX2 - clipX1);
+            clipZ1 = NEAR_CLIP;
+        }
+        if (clipZ2 < NEAR_CLIP) {
+            clipX2 += FixedMul(FixedDiv(NEAR_CLIP - clipZ2, clipZ1 - clipZ2), clipX1 - clipX2);
+            clipZ2 = NEAR_CLIP;
+        }
+
+        Sint64 widthRatio = FloatToFixed(screenW / 2.0f);
+        Sint64 centerScreenW = FloatToFixed(screenW / 2.0f);
+        Sint64 invZ1 = Reciprocal(clipZ1, FRACBITS + INV_Z_BITS);
+        Sint64 invZ2 = Reciprocal(clipZ2, FRACBITS + INV_Z_BITS);
+        float x1 = FixedWideToFloat(centerScreenW - ((((clipX1 * invZ1) >> INV_Z_BITS) * widthRatio) >> FRACBITS));
+        float x2 = FixedWideToFloat(centerScreenW - ((((clipX2 * invZ2) >> INV_Z_BITS) * widthRatio) >> FRACBITS));
+        lo = x1 < x2 ? x1 : x2;
+        hi = x1 < x2 ? x2 : x1;
+    }
+
+    if (z1 < NEAR_CLIP && (z1 <= 0 || distX1 > 0)) lo = 0;
+    if (z1 < NEAR_CLIP && z1 > 0 && distX1 <= 0) hi = screenW;
+    if (z2 < NEAR_CLIP && (z2 <= 0 || distX2 <= 0)) hi = screenW;
+    if (z2 < NEAR_CLIP && z2 > 0 && distX2 > 0) lo = 0;
+    return ColumnRange(lo, hi, startx, endx);
+}
+
+#else
+
+// Projects one front facing seg into screenSpacePolys
+static void ProjectSeg(const BspSeg* seg) {
+    Vec2 p1 = bsp.verts[seg->v1];
+    Vec2 p2 = bsp.verts[seg->v2];
+    float height = -level.polys[seg->poly].height / RES_DIV * heightScale;
+    visibility.wallsVisited++;
+    
+    if (IsFrontFace(viewCam.camPos , p1, p2) > 0) return;
+    
+    // view space positions from this frame's transform pass
+    RequireViewVertex(seg->v1);
+    RequireViewVertex(seg->v2);
+    float distX1 = viewVerts.viewX[seg->v1];
+    float z1 = viewVerts.viewZ[seg->v1];
+    float distX2 = viewVerts.viewX[seg->v2];
+    float z2 = viewVerts.viewZ[seg->v2];
+    
+    // texture u along the wall, segs made by splits continue where the previous part ended
+    float u1 = seg->offset * TEXELS_PER_UNIT;
+    float u2 = u1 + Len(p1, p2) * TEXELS_PER_UNIT;
+    
+    const float NEAR_CLIP = 0.1f;
+    
+    // Reject if the whole segment is behind the near plane
+    if (z1 <= NEAR_CLIP && z2 <= NEAR_CLIP) return;
+    
+    // If one endpoint is behind, clip it to z = NEAR_CLIP
+    if (z1 < NEAR_CLIP) {
+        float t = (NEAR_CLIP - z1) / (z2 - z1);
+        distX1 = distX1 + t * (distX2 - distX1);
+        u1 = u1 + t * (u2 - u1);
+        z1 = NEAR_CLIP;
+    }
+    if (z2 < NEAR_CLIP) {
+        float t = (NEAR_CLIP - z2) / (z1 - z2);
+        distX2 = distX2 + t * (distX1 - distX2);
+        u2 = u2 + t * (u1 - u2);
+        z2 = NEAR_CLIP;
+    }
+    
+    // Safety clamp
+    z1 = (z1 < NEAR_CLIP) ? NEAR_CLIP : z1;
+    z2 = (z2 < NEAR_CLIP) ? NEAR_CLIP : z2;
+    
+    float widthRatio = screenW / 2.0f;
+    float heightRatio = (static_cast<float>(WINDOW_W / RES_DIV) * static_cast<float>(WINDOW_H / RES_DIV)) / 60.0f * heightScale;
+    float centerScreenH = screenH / 2.0f;
+    float centerScreenW = screenW / 2.0f;
+    
+    float x1 = -distX1 * widthRatio / z1;
+    float x2 = -distX2 * widthRatio / z2;
+    float y1a = (height - heightRatio) / z1;
+    float y1b = heightRatio / z1;
+    float y2a = (height - heightRatio) / z2;
+    float y2b = heightRatio / z2;
+    
+    //wave player if walking
+    float wave = WaveOffset();
+    y1a += wave, y1b += wave, y2a += wave, y2b += wave;
+    
+    // Fill the rasterization buffer
+    ScreenSpacePoly* plane = NextScreenSpacePoly();
+    
+    plane->vert[0].x = centerScreenW + x2;
+    plane->vert[0].y = centerScreenH + y2a;
+    plane->vert[1].x = centerScreenW + x1;
+    plane->vert[1].y = centerScreenH + y1a;
+    plane->vert[2].x = centerScreenW + x1;
+    plane->vert[2].y = centerScreenH + y1b;
+    plane->vert[3].x = centerScreenW + x2;
+    plane->vert[3].y = centerScreenH + y2b;
+    
+    plane->invZ[0] = 1.0f / z1;
+    plane->invZ[1] = 1.0f / z2;
+    plane->uOverZ[0] = u1 / z1;
+    plane->uOverZ[1] = u2 / z2;
+    
+    plane->distFromCamera = (z1 + z2) / 2;
+    AddScreenSpacePoly(seg, plane);
+}
+
+// Columns [startx, endx) an edge covers, with the arithmetic of ProjectSeg so an
+// edge and a wall that share a vertex meet exactly. Only edges the camera looks
+// out through are asked about. The part of an edge between the camera and the
+// near plane runs off the side of the screen: toward the side the vertex is on
+// when it is in front of the camera, and when the edge crosses the camera plane
+// the region behind it lies to the left for a v1 behind and to the right for a
+// v2 behind, which is what keeps a camera standing in a doorway seeing through it.
+static int EdgeColumns(int v1, int v2, int* startx, int* endx) {
+    RequireViewVertex(v1);
+    RequireViewVertex(v2);
+    float distX1 = viewVerts.viewX[v1];
+    float z1 = viewVerts.viewZ[v1];
+    float distX2 = viewVerts.viewX[v2];
+    float z2 = viewVerts.viewZ[v2];
+    if (z1 <= 0 && z2 <= 0) return 0;
+
+    float lo = screenW, hi = 0;
+    const float NEAR_CLIP = 0.1f;
+    if (z1 > NEAR_CLIP || z2 > NEAR_CLIP) {
+        float clipX1 = distX1, clipZ1 = z1, clipX2 = distX2, clipZ2 = z2;
+        if (clipZ1 < NEAR_CLIP) {
+            float t = (NEAR_CLIP - clipZ1) / (clipZ2 - clipZ1);
+            clipX1 = clipX1 + t * (clipX2 - clipX1);
+            clipZ1 = NEAR_CLIP;
+        }
+        if (clipZ2 < NEAR_CLIP) {
+            float t = (NEAR_CLIP - clipZ2) / (clipZ1 - clipZ2);
+            clipX2 = clipX2 + t * (clipX1 - clipX2);
+            clipZ2 = NEAR_CLIP;
+        }
+
+        float widthRatio = screenW / 2.0f;
+        float centerScreenW = screenW / 2.0f;
+        float x1 = centerScreenW + -clipX1 * widthRatio / clipZ1;
+        float x2 = centerScreenW + -clipX2 * widthRatio / clipZ2;
+        lo = x1 < x2 ? x1 : x2;
+        hi = x1 < x2 ? x2 : x1;
+    }
+
+    if (z1 < NEAR_CLIP && (z1 <= 0 || distX1 > 0)) lo = 0;
+    if (z1 < NEAR_CLIP && z1 > 0 && distX1 <= 0) hi = screenW;
+    if (z2 < NEAR_CLIP && (z2 <= 0 || distX2 <= 0)) hi = screenW;
+    if (z2 < NEAR_CLIP && z2 > 0 && distX2 > 0) lo = 0;
+    return ColumnRange(lo, hi, startx, endx);
+}
+
+#endif
+
+// Leaves come nearest first, stop as soon as nothing farther can be seen
+static int ProjectLeaf(const BspLeaf* leaf, void* userData) {
+    for (int i = 0; i < leaf->segCount; i++) ProjectSeg(&bsp.segs[leaf->firstSeg + i]);
+    return solidColumnCount < screenW;
+}
+
+static int WindowSolid(int x0, int x1) {
+    for (int x = x0; x < x1; x++) {
+        if (!solidColumns[x]) return 0;
+    }
+    return 1;
+}
+
+static void PushRegion(int* top, int region, int from, int x0, int x1) {
+    if (*top == regionStackCapacity) {
+        regionStackCapacity = regionStackCapacity > 0 ? regionStackCapacity * 2 : 256;
+        regionStack = static_cast<RegionVisit*>(realloc(regionStack, regionStackCapacity * sizeof(RegionVisit)));
+    }
+    RegionVisit* visit = &regionStack[(*top)++];
+    visit->region = region;
+    visit->from = from;
+    visit->x0 = x0;
+    visit->x1 = x1;
+}
+
+// Visits the regions reachable from the camera's sector. A region is seen through
+// a window of columns, its walls are clipped to it and every edge the camera looks
+// out through narrows it for the region behind. Along one column the regions come
+// in the order the view ray passes them, so every column still gets its walls
+// nearest first even though the list as a whole is not sorted.
+static void ProjectPortals(int sector) {
+    Vec2 pos = viewCam.camPos;
+    int top = 0;
+    PushRegion(&top, sector, -1, 0, screenW);
+
+    while (top > 0) {
+        RegionVisit visit = regionStack[--top];
+        if (WindowSolid(visit.x0, visit.x1)) continue;
+        if (visit.region < portals.sectorCount) visibility.sectorsVisited++;
+
+        const PortalRegion* region = &portals.regions[visit.region];
+        for (int i = 0; i < region->edgeCount; i++) {
+            const PortalEdge* edge = &portals.edges[region->firstEdge + i];
+            Vec2 a = bsp.verts[edge->v1], b = bsp.verts[edge->v2];
+            if (Cross2dPoints(b.x - a.x, b.y - a.y, pos.x - a.x, pos.y - a.y) < 0) continue;
+
+            int x0, x1;
+            if (!EdgeColumns(edge->v1, edge->v2, &x0, &x1)) continue;
+            if (x0 < visit.x0) x0 = visit.x0;
+            if (x1 > visit.x1) x1 = visit.x1;
+            if (x0 >= x1) continue;
+
+            if (edge->wall >= 0) {
+                const LevelWall* wall = &level.walls[edge->wall];
+                BspSeg seg;
+                seg.v1 = wall->v1;
+                seg.v2 = wall->v2;
+                seg.wall = edge->wall;
+                seg.poly = wall->poly;
+                seg.offset = 0;
+                windowStart = x0;
+                windowEnd = x1;
+                ProjectSeg(&seg);
+            }
+
+            // a view ray never goes back to the region it came from, with the camera on
+            // an edge both sides would otherwise count as looking out through it
+            if (edge->neighbor >= 0 && edge->neighbor != visit.from) PushRegion(&top, edge->neighbor, visit.region, x0, x1);
+        }
+    }
+
+    windowStart = 0;
+    windowEnd = screenW;
+}
+
+// Projects the walls the camera can see into screenSpacePolys, through the portals
+// when the level has sectors and the camera is in one and otherwise by walking the
+// BSP tree and every leaf inside the view frustum
+void ProjectWalls() {
+    PROFILE_SCOPE("project");
+    screenSpaceVisiblePlanes = 0;
+    memset(&visibility, 0, sizeof(visibility));
+    windowStart = 0;
+    windowEnd = screenW;
+
+    solidColumns = ARENA_NEW(&frameArena, Uint8, screenW);
+    memset(solidColumns, 0, screenW);
+    solidColumnCount = 0;
+
+    int sector = LocateSector(viewCam.camPos);
+    if (sector >= 0) ProjectPortals(sector);
+    else TraverseBsp(&viewCam, ProjectLeaf, NULL);
+
+    PROFILE_COUNT(COUNTER_VISIBLE_WALLS, screenSpaceVisiblePlanes);
+    PROFILE_COUNT(COUNTER_SECTORS_VISITED, visibility.sectorsVisited);
+    PROFILE_COUNT(COUNTER_WALLS_VISITED, visibility.wallsVisited);
+}
+
+// Needs ProjectWalls() to have run, Rasterize() draws what this leaves behind
+void ProjectSprites() {
+    PROFILE_SCOPE("sprites");
+    screenSpriteCount = 0;
+    if (sprites.count == 0) return;
+
+    CullSprites(&viewCam);
+    int bandCount = (screenW + RENDER_BAND_WIDTH - 1) / RENDER_BAND_WIDTH;
+    screenSprites = ARENA_NEW(&frameArena, ScreenSprite, sprites.visibleCount > 0 ? sprites.visibleCount : 1);
+    bandSpriteStart = ARENA_NEW(&frameArena, int, bandCount + 1);
+    memset(bandSpriteStart, 0, (bandCount + 1) * sizeof(int));
+
+    // the projection of the walls, the bottom stands on the floor and the height
+    // keeps the proportions of the image
+    float widthRatio = screenW / 2.0f;
+    float heightRatio = (static_cast<float>(WINDOW_W / RES_DIV) * static_cast<float>(WINDOW_H / RES_DIV)) / 60.0f * heightScale;
+    float centerScreenW = screenW / 2.0f;
+    float centerScreenH = screenH / 2.0f + WaveOffset();
+
+    int overlaps = 0;
+    for (int i = 0; i < sprites.visibleCount; i++) {
+        int s = sprites.order[i];
+        float z = sprites.viewZ[s];
+        const SpriteImage* image = &spriteImages[sprites.image[s]];
+        float center = centerScreenW - sprites.viewX[s] * widthRatio / z;
+        float halfWidth = sprites.radius[s] * widthRatio / z;
+
+        ScreenSprite* sprite = &screenSprites[screenSpriteCount];
+        sprite->left = center - halfWidth;
+        sprite->right = center + halfWidth;
+        sprite->bottom = centerScreenH + heightRatio / z;
+        sprite->top = sprite->bottom - 2 * halfWidth * image->height / image->width;
+        sprite->invZ = 1.0f / z;
+        sprite->image = image;
+        sprite->colormap = ColormapByDistance(z);
+
+        int startx, endx;
+        if (!ColumnRange(sprite->left, sprite->right, &startx, &endx) || sprite->bottom <= 0 || sprite->top >= screenH) continue;
+        int firstBand = startx / RENDER_BAND_WIDTH, lastBand = (endx - 1) / RENDER_BAND_WIDTH;
+        for (int b = firstBand; b <= lastBand; b++) bandSpriteStart[b + 1]++;
+        overlaps += lastBand - firstBand + 1;
+        screenSpriteCount++;
+    }
+
+    // counts to starts, then every band lists its sprites in drawing order
+    for (int b = 0; b < bandCount; b++) bandSpriteStart[b + 1] += bandSpriteStart[b];
+    bandSprites = ARENA_NEW(&frameArena, int, overlaps > 0 ? overlaps : 1);
+    int* fill = ARENA_NEW(&frameArena, int, bandCount);
+    memcpy(fill, bandSpriteStart, bandCount * sizeof(int));
+    for (int i = 0; i < screenSpriteCount; i++) {
+        int startx, endx;
+        ColumnRange(screenSprites[i].left, screenSprites[i].right, &startx, &endx);
+        for (int b = startx / RENDER_BAND_WIDTH; b <= (endx - 1) / RENDER_BAND_WIDTH; b++) bandSprites[fill[b]++] = i;
+    }
+
+    PROFILE_COUNT(COUNTER_SPRITES_VISIBLE, screenSpriteCount);
+}
+
+void Render() {
+    BeginFrame();
+    TransformVertices(&viewCam);
+    ProjectWalls();
+    ProjectSprites();
+    Rasterize();
+    ExpandFrame();
+}
@@ -0,0 +1,75 @@
+#include "resolution.hpp"
+#include "engine.hpp"
+
+#include <string.h>
+
+ResolutionController resolution;
+
+// Window size times 4 / divisor, so RES_DIV 3 lands on 12 exactly
+static const int levelDivisors[RES_LEVEL_COUNT] = { 4, 6, 8, 12, 16 };
+
+void ResolutionLevelSize(int level, int* width, int* height) {
+    *width = WINDOW_W * 4 / levelDivisors[level];
+    *height = WINDOW_H * 4 / levelDivisors[level];
+}
+
+static int LevelPixels(int level) {
+    int w, h;
+    ResolutionLevelSize(level, &w, &h);
+    return w * h;
+}
+
+static void ApplyLevel(int level) {
+    int w, h;
+    resolution.level = level;
+    ResolutionLevelSize(level, &w, &h);
+    SetRenderResolution(w, h);
+}
+
+void ResolutionInit(float targetMs) {
+    memset(&resolution, 0, sizeof(resolution));
+    resolution.targetMs = targetMs;
+
+    int level = 0;
+    for (int l = 1; l < RES_LEVEL_COUNT; l++) {
+        int d = levelDivisors[l] - RES_DIV * 4, best = levelDivisors[level] - RES_DIV * 4;
+        if ((d < 0 ? -d : d) < (best < 0 ? -best : best)) level = l;
+    }
+    ApplyLevel(level);
+}
+
+int ResolutionUpdate(float frameMs) {
+    ResolutionController* r = &resolution;
+    r->frames++;
+    r->framesAtLevel[r->level]++;
+    if (r->targetMs <= 0) {
+        r->framesInBudget++;
+        return 0;
+    }
+    if (frameMs <= r->targetMs) r->framesInBudget++;
+
+    r->smoothedMs = r->frames == 1 ? frameMs : r->smoothedMs + (frameMs - r->smoothedMs) * RES_SMOOTHING;
+    if (r->cooldown > 0) {
+        r->cooldown--;
+        return 0;
+    }
+
+    r->overFrames = r->smoothedMs > r->targetMs ? r->overFrames + 1 : 0;
+
+    // render time mostly follows the pixel count
+    float predictedMs = r->level > 0 ? r->smoothedMs * LevelPixels(r->level - 1) / LevelPixels(r->level) : 0;
+    r->underFrames = r->level > 0 && predictedMs < r->targetMs * RES_UP_HEADROOM ? r->underFrames + 1 : 0;
+
+    int level = r->level;
+    if (r->overFrames >= RES_DOWN_FRAMES && level < RES_LEVEL_COUNT - 1) level++;
+    else if (r->underFrames >= RES_UP_FRAMES) level--;
+    if (level == r->level) return 0;
+
+    // the average restarts from the expected cost at the new size
+    r->smoothedMs = r->smoothedMs * LevelPixels(level) / LevelPixels(r->level);
+    r->overFrames = r->underFrames = 0;
+    r->cooldown = RES_COOLDOWN_FRAMES;
+    r->changes++;
+    ApplyLevel(level);
+    return 1;
+}
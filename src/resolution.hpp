@@ -0,0 +1,45 @@
+#pragma once
+
+// Picks the internal render resolution at runtime to hold a frame time budget.
+// Levels are fixed fractions of the window, largest first, and the finished frame
+// is scaled to the window. The controller smooths the frame time and steps:
+//
+//   down  once the smoothed time stays over budget for RES_DOWN_FRAMES frames
+//   up    once the smoothed time, scaled by the pixel count of the next level up,
+//         stays under RES_UP_HEADROOM of the budget for RES_UP_FRAMES frames
+//
+// Stepping up is slower and has to predict a fit, so the resolution does not
+// bounce between two levels. After every change it waits RES_COOLDOWN_FRAMES.
+
+#define RES_LEVEL_COUNT 5
+#define RES_SMOOTHING 0.1f     // weight of the newest frame in the moving average
+#define RES_DOWN_FRAMES 8
+#define RES_UP_FRAMES 60
+#define RES_UP_HEADROOM 0.8f
+#define RES_COOLDOWN_FRAMES 30
+#define DEFAULT_FRAME_BUDGET_MS 16.6f
+
+typedef struct {
+    float targetMs;   // 0 keeps the resolution fixed
+    int level;        // index into the level table, 0 is the full window
+    float smoothedMs;
+    int overFrames;   // consecutive frames over budget
+    int underFrames;  // consecutive frames the next level up would fit
+    int cooldown;
+
+    // stats since ResolutionInit
+    int frames;
+    int framesInBudget;
+    int changes;
+    int framesAtLevel[RES_LEVEL_COUNT];
+} ResolutionController;
+
+extern ResolutionController resolution;
+
+// Starts at the level closest to WINDOW / RES_DIV and applies it
+void ResolutionInit(float targetMs);
+
+// Feeds one frame time, returns 1 when the resolution changed for the next frame
+int ResolutionUpdate(float frameMs);
+
+void ResolutionLevelSize(int level, int* width, int* height);
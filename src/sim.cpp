@@ -0,0 +1,67 @@
+#include "sim.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+
+Simulation sim;
+
+void SimInit() {
+    sim.lastCounter = SDL_GetPerformanceCounter();
+    sim.accumulator = 0;
+    sim.previous = cam;
+    sim.ticks = 0;
+}
+
+int SimAdvance(SampleInputFunc sampleInput, void* userData) {
+    PROFILE_SCOPE("sim");
+    Uint64 now = SDL_GetPerformanceCounter();
+    double elapsed = static_cast<double>(now - sim.lastCounter) / SDL_GetPerformanceFrequency();
+    sim.lastCounter = now;
+    sim.accumulator += elapsed < SIM_MAX_FRAME ? elapsed : SIM_MAX_FRAME;
+
+    int ticks = 0;
+    while (sim.accumulator >= SIM_DT) {
+        SimTick(sampleInput(userData));
+        sim.accumulator -= SIM_DT;
+        ticks++;
+    }
+    return ticks;
+}
+
+void SimTick(PlayerInput input) {
+    sim.previous = cam;
+    cam.oldCamPos = cam.camPos;
+    CameraTranslate(input, SIM_DT);
+    CollisionDetection(SIM_DT);
+    sim.ticks++;
+}
+
+Camera SimViewCamera() {
+    float t = static_cast<float>(sim.accumulator / SIM_DT);
+    Camera view = cam;
+    view.camPos.x = sim.previous.camPos.x + (cam.camPos.x - sim.previous.camPos.x) * t;
+    view.camPos.y = sim.previous.camPos.y + (cam.camPos.y - sim.previous.camPos.y) * t;
+    view.camAngle = sim.previous.camAngle + (cam.camAngle - sim.previous.camAngle) * t;
+
+    // the wave restarts at 2 pi, carry on from there instead of going backwards
+    float wave = cam.stepWave < sim.previous.stepWave ? cam.stepWave + 2 * M_PI : cam.stepWave;
+    view.stepWave = sim.previous.stepWave + (wave - sim.previous.stepWave) * t;
+    return view;
+}
+
+void PaceFrame(double hz) {
+    static Uint64 deadline;
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    Uint64 period = static_cast<Uint64>(freq / hz);
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // a frame that ran late starts a new schedule rather than rushing to catch up
+    deadline = deadline + period > now ? deadline + period : now;
+
+    // SDL_Delay can oversleep by a millisecond or two, spin for the rest
+    Sint64 ms = static_cast<Sint64>((deadline - now) * 1000 / freq) - 2;
+    if (ms > 0) SDL_Delay(static_cast<Uint32>(ms));
+    while (SDL_GetPerformanceCounter() < deadline) {}
+}
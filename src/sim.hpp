@@ -0,0 +1,38 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// Fixed timestep simulation on the high resolution counter. Movement and collision
+// always step by SIM_DT however long a frame took, and the renderer draws the
+// camera interpolated between the last two ticks, so motion stays smooth at any
+// frame rate. Input is sampled right before each tick instead of once per frame.
+
+#define SIM_HZ 120
+#define SIM_DT (1.0 / SIM_HZ)
+#define SIM_MAX_FRAME 0.25 // seconds, a longer stall is dropped instead of caught up
+
+typedef PlayerInput (*SampleInputFunc)(void* userData);
+
+typedef struct {
+    Uint64 lastCounter;
+    double accumulator; // seconds not simulated yet
+    Camera previous;    // cam before the last tick
+    Uint64 ticks;
+} Simulation;
+
+extern Simulation sim;
+
+// Starts the clock from now with cam as both tick states
+void SimInit();
+
+// Runs every tick that is due, returns how many ran
+int SimAdvance(SampleInputFunc sampleInput, void* userData);
+
+// Runs one tick without looking at the clock, for timedemos
+void SimTick(PlayerInput input);
+
+// cam as of now, between the previous tick and the last one
+Camera SimViewCamera();
+
+// Sleeps, then spins, until 1 / hz after the previous call
+void PaceFrame(double hz);
@@ -0,0 +1,251 @@
+#include "sprite.hpp"
+#include "engine.hpp"
+#include "grid.hpp"
+#include "palette.hpp"
+#include "transform.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <stb_image.h>
+
+SpritePool sprites;
+SpriteImage spriteImages[SPRITE_MAX_IMAGES];
+int spriteImageCount;
+
+// rgba is row major from the top, the way stb_image hands it out
+static void BuildSpriteImage(SpriteImage* image, int width, int height, const unsigned char* rgba) {
+    memset(image, 0, sizeof(*image));
+    image->width = width;
+    image->height = height;
+    image->texels = static_cast<Uint8*>(malloc(width * height));
+    image->firstPost = static_cast<int*>(malloc((width + 1) * sizeof(int)));
+
+    std::vector<SpritePost> posts;
+    for (int u = 0; u < width; u++) {
+        image->firstPost[u] = posts.size();
+        int start = -1;
+        for (int v = 0; v <= height; v++) {
+            const unsigned char* p = rgba + (v * width + u) * 4;
+            int opaque = v < height && p[3] >= SPRITE_ALPHA_CUTOFF;
+            if (v < height) image->texels[u * height + v] = NearestColor(p[0], p[1], p[2]);
+
+            if (opaque && start < 0) start = v;
+            if (!opaque && start >= 0) {
+                SpritePost post;
+                post.start = start;
+                post.end = v;
+                posts.push_back(post);
+                start = -1;
+            }
+        }
+    }
+    image->firstPost[width] = posts.size();
+
+    image->posts = static_cast<SpritePost*>(malloc((posts.empty() ? 1 : posts.size()) * sizeof(SpritePost)));
+    if (!posts.empty()) memcpy(image->posts, posts.data(), posts.size() * sizeof(SpritePost));
+}
+
+int LoadSpriteImage(const char* fileName, SpriteImage* image) {
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(fileName, &width, &height, &channels, 4);
+    if (!pixels) {
+        printf("Could not load sprite %s: %s\n", fileName, stbi_failure_reason());
+        return 0;
+    }
+
+    if (width > SPRITE_MAX_SIZE || height > SPRITE_MAX_SIZE) {
+        printf("Sprite %s is %dx%d, sides can be up to %d\n", fileName, width, height, SPRITE_MAX_SIZE);
+        stbi_image_free(pixels);
+        return 0;
+    }
+
+    BuildSpriteImage(image, width, height, pixels);
+    stbi_image_free(pixels);
+    return 1;
+}
+
+void FreeSpriteImage(SpriteImage* image) {
+    free(image->texels);
+    free(image->posts);
+    free(image->firstPost);
+    memset(image, 0, sizeof(*image));
+}
+
+// Built-in images: a lit ball, a barrel and a lamp post
+static void MakeFallbackSprite(SpriteImage* image, int kind) {
+    const int size = FALLBACK_SPRITE_SIZE;
+    unsigned char rgba[size * size * 4];
+    memset(rgba, 0, sizeof(rgba));
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float fx = x + 0.5f, fy = y + 0.5f;
+            float r = 0, g = 0, b = 0, light = 1;
+            int opaque = 0;
+
+            if (kind == 0) {
+                float dx = (fx - 16) / 12, dy = (fy - 19) / 12;
+                opaque = dx * dx + dy * dy <= 1;
+                light = 1.1f - 0.5f * ((dx + 0.4f) * (dx + 0.4f) + (dy + 0.4f) * (dy + 0.4f));
+                r = 60, g = 200, b = 90;
+            } else if (kind == 1) {
+                opaque = fx >= 7 && fx < 25 && fy >= 5;
+                int band = static_cast<int>(fy) % 9 < 2;
+                light = 0.5f + 0.5f * sinf(3.14159265f * (fx - 7) / 18);
+                r = band ? 90 : 160, g = band ? 90 : 95, b = band ? 100 : 45;
+            } else {
+                float dx = fx - 16, dy = fy - 8;
+                int head = dx * dx + dy * dy <= 36;
+                opaque = head || (fx >= 15 && fx < 17);
+                r = head ? 255 : 110, g = head ? 220 : 110, b = head ? 80 : 120;
+                light = head ? 1 : 0.8f;
+            }
+
+            if (!opaque) continue;
+            if (light < 0.2f) light = 0.2f;
+            if (light > 1) light = 1;
+            unsigned char* p = &rgba[(y * size + x) * 4];
+            p[0] = static_cast<unsigned char>(r * light);
+            p[1] = static_cast<unsigned char>(g * light);
+            p[2] = static_cast<unsigned char>(b * light);
+            p[3] = 255;
+        }
+    }
+
+    BuildSpriteImage(image, size, size, rgba);
+}
+
+void InitSprites(const char* imageFile, int capacity) {
+    FreeSprites();
+
+    if (imageFile && LoadSpriteImage(imageFile, &spriteImages[0])) {
+        spriteImageCount = 1;
+    } else {
+        for (spriteImageCount = 0; spriteImageCount < 3; spriteImageCount++) MakeFallbackSprite(&spriteImages[spriteImageCount], spriteImageCount);
+    }
+
+    int n = capacity > 0 ? capacity : 1;
+    float* floats = static_cast<float*>(malloc(n * 5 * sizeof(float)));
+    sprites.x = floats;
+    sprites.y = floats + n;
+    sprites.radius = floats + n * 2;
+    sprites.viewX = floats + n * 3;
+    sprites.viewZ = floats + n * 4;
+    Uint32* ints = static_cast<Uint32*>(malloc(n * 4 * sizeof(Uint32)));
+    sprites.order = ints;
+    sprites.keys = ints + n;
+    sprites.scratch = ints + n * 2;
+    sprites.image = static_cast<Uint8*>(malloc(n));
+    sprites.capacity = capacity;
+}
+
+void FreeSprites() {
+    free(sprites.x);
+    free(sprites.order);
+    free(sprites.image);
+    memset(&sprites, 0, sizeof(sprites));
+    for (int i = 0; i < spriteImageCount; i++) FreeSpriteImage(&spriteImages[i]);
+    spriteImageCount = 0;
+}
+
+int AddSprite(float x, float y, float radius, int image) {
+    if (sprites.count == sprites.capacity) return -1;
+    int s = sprites.count++;
+    sprites.x[s] = x;
+    sprites.y[s] = y;
+    sprites.radius[s] = radius;
+    sprites.image[s] = image;
+    return s;
+}
+
+int ScatterSprites(int count, Uint32 seed) {
+    if (level.vertexCount == 0) return 0;
+
+    Vec2 lo = level.boundsMin, hi = level.boundsMax;
+    // a level without room for sprites gives up after a bounded number of tries
+    int placed = 0;
+    for (int tries = 0; placed < count && tries < count * 20; tries++) {
+        seed = seed * 1664525 + 1013904223;
+        float fx = (seed >> 8) / 16777216.0f;
+        seed = seed * 1664525 + 1013904223;
+        float fy = (seed >> 8) / 16777216.0f;
+        seed = seed * 1664525 + 1013904223;
+        float fr = (seed >> 8) / 16777216.0f;
+
+        Vec2 pos = { lo.x + (hi.x - lo.x) * fx, lo.y + (hi.y - lo.y) * fy };
+        float radius = SPRITE_MIN_RADIUS + (SPRITE_MAX_RADIUS - SPRITE_MIN_RADIUS) * fr;
+        if (!IsOpenSpot(pos, radius)) continue;
+
+        if (AddSprite(pos.x, pos.y, radius, (seed >> 24) % spriteImageCount) < 0) break;
+        placed++;
+    }
+    return placed;
+}
+
+// Four passes of 8 bits. A pass where every key has the same digit would only
+// copy, so it is left out.
+void RadixSort(Uint32* keys, Uint32* values, Uint32* scratchKeys, Uint32* scratchValues, int count) {
+    int counts[4][256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < count; i++) {
+        Uint32 k = keys[i];
+        counts[0][k & 0xFF]++;
+        counts[1][(k >> 8) & 0xFF]++;
+        counts[2][(k >> 16) & 0xFF]++;
+        counts[3][k >> 24]++;
+    }
+
+    Uint32 *srcKeys = keys, *srcValues = values, *dstKeys = scratchKeys, *dstValues = scratchValues;
+    for (int pass = 0; pass < 4; pass++) {
+        int shift = pass * 8;
+        if (count == 0 || counts[pass][(keys[0] >> shift) & 0xFF] == count) continue;
+
+        int offset = 0;
+        for (int d = 0; d < 256; d++) {
+            int n = counts[pass][d];
+            counts[pass][d] = offset;
+            offset += n;
+        }
+        for (int i = 0; i < count; i++) {
+            int at = counts[pass][(srcKeys[i] >> shift) & 0xFF]++;
+            dstKeys[at] = srcKeys[i];
+            dstValues[at] = srcValues[i];
+        }
+
+        Uint32* t = srcKeys; srcKeys = dstKeys; dstKeys = t;
+        t = srcValues; srcValues = dstValues; dstValues = t;
+    }
+
+    if (srcKeys != keys) {
+        memcpy(keys, srcKeys, count * sizeof(Uint32));
+        memcpy(values, srcValues, count * sizeof(Uint32));
+    }
+}
+
+void CullSprites(const Camera* camera) {
+    float cosA, sinA;
+    CameraSinCos(camera, &cosA, &sinA);
+    viewVerts.kernel(sprites.x, sprites.y, sprites.viewX, sprites.viewZ, sprites.count,
+        camera->camPos.x, camera->camPos.y, cosA, sinA);
+
+    // the screen edges are at x = +-z, positive z floats sort like their bits and
+    // inverting them puts the farthest first
+    int visible = 0;
+    for (int i = 0; i < sprites.count; i++) {
+        float z = sprites.viewZ[i], x = sprites.viewX[i], r = sprites.radius[i];
+        if (z <= SPRITE_NEAR_CLIP || x - r >= z || x + r <= -z) continue;
+
+        Uint32 bits;
+        memcpy(&bits, &z, sizeof(bits));
+        sprites.keys[visible] = ~bits;
+        sprites.order[visible] = i;
+        visible++;
+    }
+
+    RadixSort(sprites.keys, sprites.order, sprites.scratch, sprites.scratch + sprites.capacity, visible);
+    sprites.visibleCount = visible;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+// Billboard sprites for the things in a level: pickups, enemies, projectiles.
+// They always face the camera and stand on the floor like the walls. The pool
+// keeps every field in its own array, so the per frame pass pushes all positions
+// through the vertex transform kernel in one batch and culls them against the
+// view reading only the depth and side distance. The sprites in view are sorted
+// farthest first by a radix sort on their depth. The renderer draws them after
+// the walls of each band, clipping every column against the wall depths the wall
+// rasterizer recorded there.
+
+#define SPRITE_MAX_IMAGES 16
+#define SPRITE_MAX_SIZE 512
+#define SPRITE_NEAR_CLIP 1.0f      // closer sprites are not drawn
+#define SPRITE_ALPHA_CUTOFF 128    // image pixels with less alpha are see-through
+#define FALLBACK_SPRITE_SIZE 32
+#define SPRITE_MIN_RADIUS 4.0f     // scattered sprites get a width in this range
+#define SPRITE_MAX_RADIUS 10.0f
+
+// Rows [start, end) of one image column that are not see-through
+typedef struct {
+    Uint16 start, end;
+} SpritePost;
+
+typedef struct {
+    int width, height;
+    Uint8* texels;     // palette indices, column major, row 0 at the top
+    SpritePost* posts; // top down within a column
+    int* firstPost;    // column u has posts [firstPost[u], firstPost[u + 1])
+} SpriteImage;
+
+typedef struct {
+    float* x;        // world position of the bottom center
+    float* y;
+    float* radius;   // half the width in world units, the height follows the image
+    Uint8* image;    // into spriteImages
+    float* viewX;    // view space, from CullSprites()
+    float* viewZ;
+    Uint32* order;   // the sprites in view, farthest first
+    Uint32* keys;    // radix sort buffers
+    Uint32* scratch;
+    int count, capacity;
+    int visibleCount;
+} SpritePool;
+
+extern SpritePool sprites;
+extern SpriteImage spriteImages[SPRITE_MAX_IMAGES];
+extern int spriteImageCount;
+
+// Loads a PNG, TGA, BMP or JPEG file, alpha decides what is see-through. Returns 0
+// and prints why on failure.
+int LoadSpriteImage(const char* fileName, SpriteImage* image);
+void FreeSpriteImage(SpriteImage* image);
+
+// Sizes the pool for capacity sprites and loads imageFile as the only image, or
+// makes a few built-in ones without it or when it fails to load. Needs the palette.
+void InitSprites(const char* imageFile, int capacity);
+void FreeSprites();
+
+// Returns the new sprite or -1 when the pool is full
+int AddSprite(float x, float y, float radius, int image);
+
+// Puts up to count sprites on random spots of the open space, away from the walls
+// and outside the polygons. Needs the wall grid, returns how many were placed.
+int ScatterSprites(int count, Uint32 seed);
+
+// Transforms the whole pool into view space and fills order with the sprites in
+// front of the camera and inside the 90 degree view, farthest first
+void CullSprites(const Camera* camera);
+
+// Sorts values by their keys, smallest first and stable. The result ends up in
+// keys and values, the two scratch arrays need room for count entries.
+void RadixSort(Uint32* keys, Uint32* values, Uint32* scratchKeys, Uint32* scratchValues, int count);
@@ -0,0 +1,151 @@
+#include "texture.hpp"
+#include "palette.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_TGA
+#define STBI_ONLY_BMP
+#define STBI_ONLY_JPEG
+#include <stb_image.h>
+
+static int IsPowerOfTwo(int v) {
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+static int MipCount(int width, int height) {
+    int count = 0;
+    for (int w = width, h = height; count < TEXTURE_MAX_MIPS; w >>= 1, h >>= 1) {
+        count++;
+        if (w == 1 || h == 1) break;
+    }
+    return count;
+}
+
+size_t TextureBytes(int width, int height) {
+    size_t texels = 0;
+    for (int m = 0; m < MipCount(width, height); m++) texels += static_cast<size_t>(width >> m) * (height >> m);
+    return texels;
+}
+
+static Uint8* HeapAlloc(size_t bytes, void* userData) {
+    return static_cast<Uint8*>(malloc(bytes));
+}
+
+// Returns the texel count of the whole chain, data is NULL when alloc failed
+static int AllocTexture(Texture* texture, int width, int height, TextureAllocFunc alloc, void* userData) {
+    memset(texture, 0, sizeof(*texture));
+    texture->width = width;
+    texture->height = height;
+    texture->mipCount = MipCount(width, height);
+
+    int texels = static_cast<int>(TextureBytes(width, height));
+    texture->data = alloc(texels, userData);
+    if (!texture->data) return texels;
+    Uint8* mip = texture->data;
+    for (int m = 0; m < texture->mipCount; m++) {
+        texture->mips[m] = mip;
+        mip += (width >> m) * (height >> m);
+    }
+    return texels;
+}
+
+// Box filters every level of an RGB copy of the chain from the one above it, then
+// maps the whole chain to palette indices
+static void BuildMips(Texture* texture, Uint32* rgb, int texels) {
+    for (int m = 1; m < texture->mipCount; m++) {
+        int srcH = texture->height >> (m - 1);
+        int w = texture->width >> m, h = texture->height >> m;
+        const Uint32* src = rgb + (texture->mips[m - 1] - texture->data);
+        Uint32* dst = rgb + (texture->mips[m] - texture->data);
+
+        for (int u = 0; u < w; u++) {
+            for (int v = 0; v < h; v++) {
+                const Uint32* a = src + (u * 2) * srcH + v * 2;
+                const Uint32* b = a + srcH;
+                Uint32 rb = (a[0] & 0xFF00FF) + (a[1] & 0xFF00FF) + (b[0] & 0xFF00FF) + (b[1] & 0xFF00FF);
+                Uint32 g = (a[0] & 0x00FF00) + (a[1] & 0x00FF00) + (b[0] & 0x00FF00) + (b[1] & 0x00FF00);
+                dst[u * h + v] = 0xFF000000 | ((rb >> 2) & 0xFF00FF) | ((g >> 2) & 0x00FF00);
+            }
+        }
+    }
+
+    for (int i = 0; i < texels; i++) texture->data[i] = NearestColor(rgb[i] >> 16, rgb[i] >> 8, rgb[i]);
+}
+
+int LoadTexture(const char* fileName, Texture* texture) {
+    return DecodeTexture(fileName, texture, HeapAlloc, NULL);
+}
+
+int DecodeTexture(const char* fileName, Texture* texture, TextureAllocFunc alloc, void* userData) {
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(fileName, &width, &height, &channels, 4);
+    if (!pixels) {
+        printf("Could not load texture %s: %s\n", fileName, stbi_failure_reason());
+        return 0;
+    }
+
+    if (!IsPowerOfTwo(width) || !IsPowerOfTwo(height) || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE) {
+        printf("Texture %s is %dx%d, sides must be powers of two up to %d\n", fileName, width, height, TEXTURE_MAX_SIZE);
+        stbi_image_free(pixels);
+        return 0;
+    }
+
+    // the scratch copy comes first, the block from alloc cannot be given back here
+    Uint32* rgb = static_cast<Uint32*>(malloc(TextureBytes(width, height) * sizeof(Uint32)));
+    int texels = rgb ? AllocTexture(texture, width, height, alloc, userData) : 0;
+    if (!rgb || !texture->data) {
+        printf("Out of memory for texture %s\n", fileName);
+        free(rgb);
+        stbi_image_free(pixels);
+        return 0;
+    }
+
+    // rows come top down and columns are stored bottom up. Wall u runs from the
+    // right of the screen to the left, so columns are stored right to left too.
+    for (int u = 0; u < width; u++) {
+        Uint32* column = rgb + u * height;
+        for (int v = 0; v < height; v++) {
+            const unsigned char* p = pixels + ((height - 1 - v) * width + (width - 1 - u)) * 4;
+            column[v] = 0xFF000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+        }
+    }
+
+    stbi_image_free(pixels);
+    BuildMips(texture, rgb, texels);
+    free(rgb);
+    return 1;
+}
+
+void MakeFallbackTexture(Texture* texture) {
+    const int size = FALLBACK_TEXTURE_SIZE, brickW = 32, brickH = 16, mortar = 2;
+    int texels = AllocTexture(texture, size, size, HeapAlloc, NULL);
+    Uint32* rgb = static_cast<Uint32*>(malloc(texels * sizeof(Uint32)));
+
+    for (int u = 0; u < size; u++) {
+        for (int v = 0; v < size; v++) {
+            int row = v / brickH;
+            int x = (u + (row & 1) * brickW / 2) % size;
+            Uint32 color = 0xFF9A9A92;
+
+            if (x % brickW >= mortar && v % brickH >= mortar) {
+                // every brick gets its own shade of red
+                Uint32 hash = (row * 73856093u) ^ ((x / brickW) * 19349663u);
+                int shade = (hash >> 7) % 40;
+                color = 0xFF000000 | ((150 + shade) << 16) | ((60 + shade / 2) << 8) | (40 + shade / 3);
+            }
+            rgb[u * size + v] = color;
+        }
+    }
+
+    BuildMips(texture, rgb, texels);
+    free(rgb);
+}
+
+void FreeTexture(Texture* texture) {
+    free(texture->data);
+    memset(texture, 0, sizeof(*texture));
+}
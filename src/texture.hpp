@@ -0,0 +1,42 @@
+#pragma once
+
+#include "typedefs.hpp"
+
+#include <stddef.h>
+
+// Wall textures. Texels are palette indices stored column major, one texture
+// column after the other, so filling a vertical wall span walks memory linearly.
+// Every texture carries its full mip chain in the same block. Mips are filtered
+// in RGB and mapped to the palette afterwards, so BuildPalette() must run first.
+
+#define TEXTURE_MAX_SIZE 1024
+#define TEXTURE_MAX_MIPS 11     // log2(TEXTURE_MAX_SIZE) + 1
+#define TEXELS_PER_UNIT 1.0f    // texture repeats every width world units along a wall
+#define FALLBACK_TEXTURE_SIZE 64
+
+typedef struct {
+    int width, height;  // powers of two
+    int mipCount;       // halves both sides until one of them is 1
+    Uint8* mips[TEXTURE_MAX_MIPS];   // mip m column u starts at mips[m] + u * (height >> m), u = 0 is
+                                    // the right edge of the image and v = 0 the bottom row
+    Uint8* data;
+} Texture;
+
+// Gives the block for a whole mip chain, data points at it and is left to the caller
+typedef Uint8* (*TextureAllocFunc)(size_t bytes, void* userData);
+
+// Loads a PNG, TGA, BMP or JPEG file whose sides are powers of two, returns 0 and
+// prints why on failure
+int LoadTexture(const char* fileName, Texture* texture);
+
+// The same with the chain in a block from alloc, safe on any thread once the
+// palette is built. Returns 0 without allocating on failure.
+int DecodeTexture(const char* fileName, Texture* texture, TextureAllocFunc alloc, void* userData);
+
+// Bytes of the block a chain for these sides needs
+size_t TextureBytes(int width, int height);
+
+// Procedural brick pattern, used when no texture file is available
+void MakeFallbackTexture(Texture* texture);
+
+void FreeTexture(Texture* texture);
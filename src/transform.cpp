@@ -0,0 +1,186 @@
+#include "transform.hpp"
+#include "bsp.hpp"
+#include "cpu.hpp"
+#include "profiler.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+
+ViewVertices viewVerts;
+
+// Camera of the frame being drawn, for the lazy vertices
+#ifdef DOOM_FIXED_POINT
+static Fixed lazyFixedCamX, lazyFixedCamY, lazyFixedCos, lazyFixedSin;
+#else
+static float lazyCamX, lazyCamY, lazyCos, lazySin;
+#endif
+
+void TransformScalar(const float* worldX, const float* worldY, float* viewX, float* viewZ, int count,
+    float camX, float camY, float cosA, float sinA) {
+    for (int i = 0; i < count; i++) {
+        float dx = worldX[i] - camX;
+        float dy = worldY[i] - camY;
+        viewZ[i] = dx * cosA + dy * sinA;
+        viewX[i] = dx * sinA - dy * cosA;
+    }
+}
+
+#ifdef DOOM_X86
+
+// SSE2 is part of every x86-64 CPU, the tail that does not fill a register goes
+// through the scalar loop
+static void TransformSSE(const float* worldX, const float* worldY, float* viewX, float* viewZ, int count,
+    float camX, float camY, float cosA, float sinA) {
+    __m128 cx = _mm_set1_ps(camX), cy = _mm_set1_ps(camY);
+    __m128 c = _mm_set1_ps(cosA), s = _mm_set1_ps(sinA);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(worldX + i), cx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(worldY + i), cy);
+        _mm_storeu_ps(viewZ + i, _mm_add_ps(_mm_mul_ps(dx, c), _mm_mul_ps(dy, s)));
+        _mm_storeu_ps(viewX + i, _mm_sub_ps(_mm_mul_ps(dx, s), _mm_mul_ps(dy, c)));
+    }
+
+    TransformScalar(worldX + i, worldY + i, viewX + i, viewZ + i, count - i, camX, camY, cosA, sinA);
+}
+
+TARGET_AVX2 static void TransformAVX2(const float* worldX, const float* worldY, float* viewX, float* viewZ, int count,
+    float camX, float camY, float cosA, float sinA) {
+    __m256 cx = _mm256_set1_ps(camX), cy = _mm256_set1_ps(camY);
+    __m256 c = _mm256_set1_ps(cosA), s = _mm256_set1_ps(sinA);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(worldX + i), cx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(worldY + i), cy);
+        _mm256_storeu_ps(viewZ + i, _mm256_add_ps(_mm256_mul_ps(dx, c), _mm256_mul_ps(dy, s)));
+        _mm256_storeu_ps(viewX + i, _mm256_sub_ps(_mm256_mul_ps(dx, s), _mm256_mul_ps(dy, c)));
+    }
+
+    TransformScalar(worldX + i, worldY + i, viewX + i, viewZ + i, count - i, camX, camY, cosA, sinA);
+}
+
+const TransformKernel transformKernels[] = {
+    { "scalar", TransformScalar, AlwaysSupported },
+    { "sse", TransformSSE, AlwaysSupported },
+    { "avx2", TransformAVX2, HasAVX2 },
+};
+
+#else
+
+const TransformKernel transformKernels[] = {
+    { "scalar", TransformScalar, AlwaysSupported },
+};
+
+#endif
+
+const int transformKernelCount = sizeof(transformKernels) / sizeof(transformKernels[0]);
+
+void AllocTransformBuffers() {
+    FreeTransformBuffers();
+
+    int count = bsp.vertCount;
+    float* block = static_cast<float*>(malloc((count > 0 ? count : 1) * 4 * sizeof(float)));
+    viewVerts.worldX = block;
+    viewVerts.worldY = block + count;
+    viewVerts.viewX = block + count * 2;
+    viewVerts.viewZ = block + count * 3;
+    viewVerts.count = count;
+    viewVerts.stamp = static_cast<Uint32*>(calloc(count > 0 ? count : 1, sizeof(Uint32)));
+    viewVerts.frame = 0;
+
+    for (int i = 0; i < count; i++) {
+        viewVerts.worldX[i] = bsp.verts[i].x;
+        viewVerts.worldY[i] = bsp.verts[i].y;
+    }
+
+    for (int k = 0; k < transformKernelCount; k++) {
+        if (transformKernels[k].supported()) viewVerts.kernel = transformKernels[k].fn;
+    }
+
+#ifdef DOOM_FIXED_POINT
+    Fixed* fixedBlock = static_cast<Fixed*>(malloc((count > 0 ? count : 1) * 4 * sizeof(Fixed)));
+    viewVerts.fixedWorldX = fixedBlock;
+    viewVerts.fixedWorldY = fixedBlock + count;
+    viewVerts.fixedViewX = fixedBlock + count * 2;
+    viewVerts.fixedViewZ = fixedBlock + count * 3;
+    for (int i = 0; i < count; i++) {
+        viewVerts.fixedWorldX[i] = FloatToFixed(bsp.verts[i].x);
+        viewVerts.fixedWorldY[i] = FloatToFixed(bsp.verts[i].y);
+    }
+#endif
+}
+
+void FreeTransformBuffers() {
+    free(viewVerts.worldX);
+    viewVerts.worldX = viewVerts.worldY = viewVerts.viewX = viewVerts.viewZ = NULL;
+    free(viewVerts.stamp);
+    viewVerts.stamp = NULL;
+#ifdef DOOM_FIXED_POINT
+    free(viewVerts.fixedWorldX);
+    viewVerts.fixedWorldX = viewVerts.fixedWorldY = viewVerts.fixedViewX = viewVerts.fixedViewZ = NULL;
+#endif
+    viewVerts.count = 0;
+}
+
+void TransformVertices(const Camera* camera) {
+    PROFILE_SCOPE("transform");
+#ifdef DOOM_FIXED_POINT
+    Angle angle = AngleFromRadians(camera->camAngle);
+    Fixed cosA = FixedCos(angle), sinA = FixedSin(angle);
+    Fixed camX = FloatToFixed(camera->camPos.x), camY = FloatToFixed(camera->camPos.y);
+    if (viewVerts.lazy) {
+        lazyFixedCamX = camX;
+        lazyFixedCamY = camY;
+        lazyFixedCos = cosA;
+        lazyFixedSin = sinA;
+        viewVerts.frame++;
+        return;
+    }
+    for (int i = 0; i < viewVerts.count; i++) {
+        Fixed dx = viewVerts.fixedWorldX[i] - camX;
+        Fixed dy = viewVerts.fixedWorldY[i] - camY;
+        viewVerts.fixedViewZ[i] = FixedMul(dx, cosA) + FixedMul(dy, sinA);
+        viewVerts.fixedViewX[i] = FixedMul(dx, sinA) - FixedMul(dy, cosA);
+    }
+#else
+    float cosA, sinA;
+    CameraSinCos(camera, &cosA, &sinA);
+    if (viewVerts.lazy) {
+        lazyCamX = camera->camPos.x;
+        lazyCamY = camera->camPos.y;
+        lazyCos = cosA;
+        lazySin = sinA;
+        viewVerts.frame++;
+        return;
+    }
+    viewVerts.kernel(viewVerts.worldX, viewVerts.worldY, viewVerts.viewX, viewVerts.viewZ, viewVerts.count,
+        camera->camPos.x, camera->camPos.y, cosA, sinA);
+#endif
+}
+
+// The scalar kernel on one vertex, which matches what the whole pool would get
+void TransformVertex(int v) {
+#ifdef DOOM_FIXED_POINT
+    Fixed dx = viewVerts.fixedWorldX[v] - lazyFixedCamX;
+    Fixed dy = viewVerts.fixedWorldY[v] - lazyFixedCamY;
+    viewVerts.fixedViewZ[v] = FixedMul(dx, lazyFixedCos) + FixedMul(dy, lazyFixedSin);
+    viewVerts.fixedViewX[v] = FixedMul(dx, lazyFixedSin) - FixedMul(dy, lazyFixedCos);
+#else
+    TransformScalar(&viewVerts.worldX[v], &viewVerts.worldY[v], &viewVerts.viewX[v], &viewVerts.viewZ[v], 1,
+        lazyCamX, lazyCamY, lazyCos, lazySin);
+#endif
+    viewVerts.stamp[v] = viewVerts.frame;
+}
+
+void CameraSinCos(const Camera* camera, float* cosA, float* sinA) {
+#ifdef DOOM_FIXED_POINT
+    Angle angle = AngleFromRadians(camera->camAngle);
+    *cosA = FixedToFloat(FixedCos(angle));
+    *sinA = FixedToFloat(FixedSin(angle));
+#else
+    *cosA = cosf(camera->camAngle);
+    *sinA = sinf(camera->camAngle);
+#endif
+}
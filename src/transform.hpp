@@ -0,0 +1,66 @@
+#pragma once
+
+#include "fixed.hpp"
+#include "typedefs.hpp"
+
+// Once per frame pass that moves the whole vertex pool into view space. The
+// pool is kept as separate x and y arrays so the kernels load and store whole
+// SIMD registers, projection then reads view x and z by vertex index.
+//
+//   z = dx * cos + dy * sin   distance along the view direction
+//   x = dx * sin - dy * cos   distance to the side, positive is left
+//
+// Every kernel evaluates exactly these operations in this order and without
+// fused multiply-add, so they all give bit identical results. The
+// DOOM_FIXED_POINT backend skips the kernels and transforms in 16.16 instead.
+//
+// Levels drawn through portals only touch the vertices of the regions they
+// reach. With lazy set, TransformVertices() just takes the camera and every
+// vertex is transformed the first time RequireViewVertex() asks for it.
+
+typedef void (*TransformFunc)(const float* worldX, const float* worldY, float* viewX, float* viewZ, int count,
+    float camX, float camY, float cosA, float sinA);
+
+typedef struct {
+    const char* name;
+    TransformFunc fn;
+    int (*supported)();
+} TransformKernel;
+
+typedef struct {
+    float* worldX;
+    float* worldY;
+    float* viewX;
+    float* viewZ;
+    int count;
+    TransformFunc kernel; // fastest one the CPU supports
+    int lazy;
+    Uint32* stamp;        // frame each vertex was last transformed in, when lazy
+    Uint32 frame;
+#ifdef DOOM_FIXED_POINT
+    Fixed* fixedWorldX;
+    Fixed* fixedWorldY;
+    Fixed* fixedViewX;
+    Fixed* fixedViewZ;
+#endif
+} ViewVertices;
+
+extern ViewVertices viewVerts;
+
+// Every kernel compiled into this build, scalar first
+extern const TransformKernel transformKernels[];
+extern const int transformKernelCount;
+
+// Copies the BSP vertex pool, which includes the vertices made by splits
+void AllocTransformBuffers();
+void FreeTransformBuffers();
+
+void TransformVertices(const Camera* camera);
+void TransformVertex(int v);
+
+inline void RequireViewVertex(int v) {
+    if (viewVerts.lazy && viewVerts.stamp[v] != viewVerts.frame) TransformVertex(v);
+}
+
+// Cosine and sine of the view angle, from the fixed point tables in that backend
+void CameraSinCos(const Camera* camera, float* cosA, float* sinA);
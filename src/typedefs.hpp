@@ -1,11 +1,8 @@
-#include <SDL2/SDL_stdinc.h>
+#pragma once
 
-#define MAX_POLYS 10
-#define MAX_VERTS 8
+#include <SDL2/SDL_stdinc.h>
 
-#define SHOULD_RASTERIZE 1 // 1 is on and 0 if off
-#define RASTER_RESOLUTION 1 // decrease for better resolution, increase for performance
-#define RASTER_NUM_VERTS 4
+#define RENDER_BAND_WIDTH 16 // columns per raster job, fixed so every thread count gives the same image
 
 typedef struct Vec2 {
     float x, y;
@@ -16,16 +13,12 @@ typedef struct {
 } LineSeg;
  
 typedef struct {
-    Vec2 vert[MAX_VERTS];
-    int vertCnt;
-    float height;
-    float curDist;
-} Polygon;
- 
-typedef struct {
-    Vec2 vert[4];
+    Vec2 vert[4]; // top and bottom of one vertical edge in 1 and 2, of the other in 0 and 3
+    float invZ[2];   // 1 / z at the vert[1] edge and at the vert[0] edge
+    float uOverZ[2]; // texture u / z at the same edges, both interpolate linearly on screen
     float distFromCamera;
     int planeIdInPoly;
+    Sint16 windowStart, windowEnd; // columns it may fill, narrowed by the portals it was seen through
 } ScreenSpacePoly;
 
 typedef struct{
@@ -36,5 +29,5 @@ typedef struct{
 } Camera;
 
 typedef struct {
-    Uint8 R, G, B;
-} Color;
\ No newline at end of file
+    Uint8 forward, back, left, right;
+} PlayerInput;
\ No newline at end of file
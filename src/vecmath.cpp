@@ -0,0 +1,67 @@
+#include "engine.hpp"
+
+#include <math.h>
+
+float Cross2dPoints(float x1, float y1, float x2, float y2) {
+    return x1 * y2 - y1 * x2;
+}
+
+Vec2 Intersection(float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
+    Vec2 p;
+
+    p.x = Cross2dPoints(x1, y1, x2, y2);
+    p.y = Cross2dPoints(x3, y3, x4, y4);
+    float det = Cross2dPoints(x1 - x2, y1 - y2, x3 - x4, y3 - y4);
+    p.x = Cross2dPoints(p.x, x1 - x2, p.y, x3 - x4) / det;
+    p.y = Cross2dPoints(p.x, y1 - y2, p.y, y3 - y4) / det;
+    
+    return p;
+}
+
+float DotPoints(float x1, float y1, float x2, float y2) {
+    return x1 * x2 + y1 * y2;
+}
+ 
+float Dot(Vec2 pointA, Vec2 pointB) {
+    return DotPoints(pointA.x, pointA.y, pointB.x, pointB.y);
+}
+ 
+Vec2 Normalize(Vec2 vec) {
+    float len = sqrt((vec.x * vec.x) + (vec.y * vec.y));
+    Vec2 normalized;
+    normalized.x = vec.x / len;
+    normalized.y = vec.y / len;
+ 
+    return normalized;
+}
+ 
+Vec2 VecMinus(Vec2 v1, Vec2 v2) {
+    Vec2 v3;
+    v3.x = v1.x - v2.x;
+    v3.y = v1.y - v2.y;
+ 
+    return v3;
+}
+ 
+Vec2 VecPlus(Vec2 v1, Vec2 v2) {
+    Vec2 v3;
+    v3.x = v1.x + v2.x;
+    v3.y = v1.y + v2.y;
+ 
+    return v3;
+}
+ 
+Vec2 VecMulF(Vec2 v1, float val) {
+    Vec2 v2;
+    v2.x = v1.x * val;
+    v2.y = v1.y * val;
+ 
+    return v2;
+}
+ 
+float Len(Vec2 pointA, Vec2 pointB) {
+    float distX = pointB.x - pointA.x;
+    float distY = pointB.y - pointA.y;
+ 
+    return sqrt((distX * distX) + (distY * distY));
+}
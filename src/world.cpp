@@ -0,0 +1,110 @@
+#include "actor.hpp"
+#include "assets.hpp"
+#include "bsp.hpp"
+#include "engine.hpp"
+#include "fixed.hpp"
+#include "grid.hpp"
+#include "palette.hpp"
+#include "portal.hpp"
+#include "sprite.hpp"
+#include "transform.hpp"
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+Camera cam;
+LoadStats loadStats;
+
+void CameraTranslate(PlayerInput input, double deltaTime) {
+#ifdef DOOM_FIXED_POINT
+    // the step is worked out in 16.16 from the sine table, the position stays a float
+    Angle angle = AngleFromRadians(cam.camAngle);
+    Fixed step = FloatToFixed(static_cast<float>(MOV_SPEED * deltaTime));
+    Fixed stepX = FixedMul(step, FixedCos(angle)), stepY = FixedMul(step, FixedSin(angle));
+    if (input.forward) {
+        cam.camPos.x = FixedToFloat(FloatToFixed(cam.camPos.x) + stepX);
+        cam.camPos.y = FixedToFloat(FloatToFixed(cam.camPos.y) + stepY);
+        cam.stepWave += 3 * deltaTime;
+    } else if (input.back) {
+        cam.camPos.x = FixedToFloat(FloatToFixed(cam.camPos.x) - stepX);
+        cam.camPos.y = FixedToFloat(FloatToFixed(cam.camPos.y) - stepY);
+        cam.stepWave += 3 * deltaTime;
+    }
+#else
+    if (input.forward) {
+        cam.camPos.x += MOV_SPEED * cos(cam.camAngle) * deltaTime;
+        cam.camPos.y += MOV_SPEED * sin(cam.camAngle) * deltaTime;
+        cam.stepWave += 3 * deltaTime;
+    } else if (input.back) {
+        cam.camPos.x -= MOV_SPEED * cos(cam.camAngle) * deltaTime;
+        cam.camPos.y -= MOV_SPEED * sin(cam.camAngle) * deltaTime;
+        cam.stepWave += 3 * deltaTime;
+    }
+#endif
+
+    if (cam.stepWave > M_PI*2) cam.stepWave = 0;
+ 
+    if (input.left) {
+        cam.camAngle -= ROT_SPEED * deltaTime;
+    } else if (input.right) {
+        cam.camAngle += ROT_SPEED * deltaTime;
+    }
+}
+
+// Loads a level and sizes all engine storage from it. The texture file streams in
+// on the asset loader, walls get the built-in texture until it is there or if it
+// fails to load.
+int Init(const char* levelFile, const char* textureFile) {
+    double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (!LoadLevel(levelFile)) return 0;
+
+    Uint64 loaded = SDL_GetPerformanceCounter();
+    if (!BuildBsp()) {
+        printf("Level %s has no walls\n", levelFile);
+        UnloadLevel();
+        return 0;
+    }
+
+    Uint64 bspBuilt = SDL_GetPerformanceCounter();
+    BuildWallGrid();
+
+    loadStats.levelMs = (loaded - start) * toMs;
+    loadStats.bspBuildMs = (bspBuilt - loaded) * toMs;
+    loadStats.gridBuildMs = (SDL_GetPerformanceCounter() - bspBuilt) * toMs;
+
+    BuildPortals();
+    BuildPalette();
+    BuildFixedTables();
+    AllocRenderBuffers();
+    MakeFallbackTexture(&wallTexture);
+    InitAssets(ASSET_DEFAULT_BUDGET);
+    wallTextureAsset = textureFile ? RequestTexture(textureFile) : -1;
+    AllocTransformBuffers();
+    viewVerts.lazy = portals.regionCount > 0;
+
+    memset(&cam, 0, sizeof(cam));
+    cam.camAngle = level.header->spawnAngle;
+    cam.camPos.x = level.header->spawnX;
+    cam.camPos.y = level.header->spawnY;
+    cam.oldCamPos = cam.camPos;
+
+    return 1;
+}
+
+void Shutdown() {
+    FreeActors();
+    FreeSprites();
+    FreeRenderBuffers();
+    ShutdownAssets();
+    wallTextureAsset = -1;
+    FreeTexture(&wallTexture);
+    FreeTransformBuffers();
+    FreeWallGrid();
+    FreePortals();
+    FreeBsp();
+    UnloadLevel();
+}
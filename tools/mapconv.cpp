@@ -0,0 +1,414 @@
+// Converts a text level (see maps/default.txt) into the binary format from
+// level.hpp, or generates a large synthetic level for benchmarking: a grid of
+// pillars, or a grid of rooms joined by doorways that comes with sectors.
+//
+// usage: DOOM_mapconv <input.txt> <output.lvl>
+//        DOOM_mapconv --generate <wallCount> <output.lvl>
+//        DOOM_mapconv --rooms <side> <output.lvl>
+
+#include "level.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <tuple>
+#include <vector>
+
+typedef struct {
+    std::vector<Vec2> verts;
+    std::vector<LevelWall> walls;
+    std::vector<LevelPoly> polys;
+    std::vector<std::vector<Vec2>> sectorOutlines; // corners as written, resolved into the two tables below
+    std::vector<LevelSector> sectors;
+    std::vector<LevelSectorEdge> sectorEdges;
+    float spawnX, spawnY, spawnAngle;
+} LevelSource;
+
+typedef std::tuple<float, float, float, float> EdgeKey;
+
+static void BeginPoly(LevelSource* src, float height) {
+    LevelPoly poly;
+    poly.firstVertex = src->verts.size();
+    poly.vertexCount = 0;
+    poly.firstWall = src->walls.size();
+    poly.wallCount = 0;
+    poly.height = height;
+    src->polys.push_back(poly);
+}
+
+static void AddVertex(LevelSource* src, float x, float y) {
+    Vec2 v;
+    v.x = x;
+    v.y = y;
+    src->verts.push_back(v);
+    src->polys.back().vertexCount++;
+}
+
+// Walls join consecutive vertices and the last vertex back to the first
+static void EndPoly(LevelSource* src) {
+    if (src->polys.empty()) return;
+
+    LevelPoly* poly = &src->polys.back();
+    for (Uint32 i = 0; i < poly->vertexCount; i++) {
+        LevelWall wall;
+        wall.v1 = poly->firstVertex + i;
+        wall.v2 = poly->firstVertex + (i + 1) % poly->vertexCount;
+        wall.poly = src->polys.size() - 1;
+        wall.flags = 0;
+        src->walls.push_back(wall);
+    }
+    poly->wallCount = poly->vertexCount;
+}
+
+static int ParseText(const char* fileName, LevelSource* src) {
+    FILE* file = fopen(fileName, "r");
+    if (!file) {
+        printf("Could not open %s\n", fileName);
+        return 0;
+    }
+
+    char line[256];
+    int lineNum = 0, ok = 1;
+    while (ok && fgets(line, sizeof(line), file)) {
+        float a, b, c;
+        lineNum++;
+
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+
+        if (sscanf(line, "spawn %f %f %f", &a, &b, &c) == 3) {
+            src->spawnX = a;
+            src->spawnY = b;
+            src->spawnAngle = c;
+        } else if (strncmp(line, "sector", 6) == 0) {
+            src->sectorOutlines.emplace_back();
+        } else if (sscanf(line, "s %f %f", &a, &b) == 2 && !src->sectorOutlines.empty()) {
+            Vec2 corner;
+            corner.x = a;
+            corner.y = b;
+            src->sectorOutlines.back().push_back(corner);
+        } else if (sscanf(line, "poly %f", &a) == 1) {
+            EndPoly(src);
+            BeginPoly(src, a);
+        } else if (sscanf(line, "v %f %f", &a, &b) == 2 && !src->polys.empty()) {
+            AddVertex(src, a, b);
+        } else {
+            printf("%s:%d: cannot parse '%s'\n", fileName, lineNum, line);
+            ok = 0;
+        }
+    }
+    EndPoly(src);
+
+    fclose(file);
+    return ok;
+}
+
+// A grid of square pillars with four walls each, heights cycle so the
+// skyline is not flat. The camera starts in the first gap.
+static void Generate(int wallCount, LevelSource* src) {
+    const float spacing = 80, size = 30;
+    const float heights[] = { 1000, 10000, 50000 };
+
+    int pillars = (wallCount + 3) / 4;
+    int side = static_cast<int>(ceil(sqrt(static_cast<double>(pillars))));
+
+    for (int i = 0; i < pillars; i++) {
+        float x = (i % side) * spacing;
+        float y = (i / side) * spacing;
+
+        BeginPoly(src, heights[(i * 7 + i / side) % 3]);
+        AddVertex(src, x, y);
+        AddVertex(src, x + size, y);
+        AddVertex(src, x + size, y + size);
+        AddVertex(src, x, y + size);
+        EndPoly(src);
+    }
+
+    src->spawnX = size + (spacing - size) / 2;
+    src->spawnY = size + (spacing - size) / 2;
+    src->spawnAngle = 0.785f;
+}
+
+static void AddRoomBlock(LevelSource* src, float x0, float y0, float x1, float y1, float height) {
+    BeginPoly(src, height);
+    AddVertex(src, x0, y0);
+    AddVertex(src, x1, y0);
+    AddVertex(src, x1, y1);
+    AddVertex(src, x0, y1);
+    EndPoly(src);
+}
+
+static void AddRoomSector(LevelSource* src, const float (*corners)[2], int count) {
+    src->sectorOutlines.emplace_back();
+    for (int i = 0; i < count; i++) {
+        Vec2 corner;
+        corner.x = corners[i][0];
+        corner.y = corners[i][1];
+        src->sectorOutlines.back().push_back(corner);
+    }
+}
+
+// side * side square rooms. The walls between them are blocks with a doorway at a
+// random place, so there is rarely a straight view through more than a few rooms,
+// and square pillars join the walls at the corners. Every room and every doorway
+// is a sector. Inner walls come in two heights, the outer ones are all tall.
+static void GenerateRooms(int side, LevelSource* src) {
+    const float pitch = 400, thickness = 20, door = 80;
+    const float heights[] = { 10000, 50000 };
+    Uint32 rng = 12345;
+
+    // doorGap[line][cell] is where the doorway in that wall starts, vertical lines first
+    std::vector<float> doorGaps(2 * (side + 1) * side);
+    for (size_t i = 0; i < doorGaps.size(); i++) {
+        rng = rng * 1664525 + 1013904223;
+        float room = pitch - thickness;
+        doorGaps[i] = 2 * thickness + static_cast<float>((rng >> 8) % static_cast<Uint32>(room - door - 3 * thickness));
+    }
+    auto gapStart = [&](int vertical, int line, int cell) {
+        return cell * pitch + doorGaps[((vertical ? 0 : side + 1) + line) * side + cell];
+    };
+
+    for (int l = 0; l <= side; l++) {
+        for (int k = 0; k <= side; k++) {
+            AddRoomBlock(src, k * pitch, l * pitch, k * pitch + thickness, l * pitch + thickness, heights[1]);
+        }
+    }
+
+    for (int vertical = 0; vertical < 2; vertical++) {
+        for (int line = 0; line <= side; line++) {
+            int inner = line > 0 && line < side;
+            for (int cell = 0; cell < side; cell++) {
+                rng = rng * 1664525 + 1013904223;
+                float height = inner ? heights[(rng >> 16) & 1] : heights[1];
+                float a0 = line * pitch, a1 = a0 + thickness;       // across the wall
+                float b0 = cell * pitch + thickness, b1 = (cell + 1) * pitch; // along it
+                float g0 = gapStart(vertical, line, cell), g1 = g0 + door;
+
+                float pieces[2][2] = { { b0, inner ? g0 : b1 }, { g1, b1 } };
+                for (int p = 0; p < (inner ? 2 : 1); p++) {
+                    if (vertical) AddRoomBlock(src, a0, pieces[p][0], a1, pieces[p][1], height);
+                    else AddRoomBlock(src, pieces[p][0], a0, pieces[p][1], a1, height);
+                }
+                if (!inner) continue;
+
+                if (vertical) {
+                    const float corners[4][2] = { { a0, g0 }, { a1, g0 }, { a1, g1 }, { a0, g1 } };
+                    AddRoomSector(src, corners, 4);
+                } else {
+                    const float corners[4][2] = { { g0, a0 }, { g1, a0 }, { g1, a1 }, { g0, a1 } };
+                    AddRoomSector(src, corners, 4);
+                }
+            }
+        }
+    }
+
+    // the room outlines run counter-clockwise and pick up the doorway corners on the way
+    for (int j = 0; j < side; j++) {
+        for (int i = 0; i < side; i++) {
+            float x0 = i * pitch + thickness, x1 = (i + 1) * pitch;
+            float y0 = j * pitch + thickness, y1 = (j + 1) * pitch;
+            float corners[12][2];
+            int count = 0;
+            auto corner = [&](float x, float y) {
+                corners[count][0] = x;
+                corners[count][1] = y;
+                count++;
+            };
+
+            corner(x0, y0);
+            if (j > 0) {
+                corner(gapStart(0, j, i), y0);
+                corner(gapStart(0, j, i) + door, y0);
+            }
+            corner(x1, y0);
+            if (i + 1 < side) {
+                corner(x1, gapStart(1, i + 1, j));
+                corner(x1, gapStart(1, i + 1, j) + door);
+            }
+            corner(x1, y1);
+            if (j + 1 < side) {
+                corner(gapStart(0, j + 1, i) + door, y1);
+                corner(gapStart(0, j + 1, i), y1);
+            }
+            corner(x0, y1);
+            if (i > 0) {
+                corner(x0, gapStart(1, i, j) + door);
+                corner(x0, gapStart(1, i, j));
+            }
+            AddRoomSector(src, corners, count);
+        }
+    }
+
+    src->spawnX = src->spawnY = (thickness + pitch) / 2;
+    src->spawnAngle = 0.785f;
+}
+
+static EdgeKey KeyOf(Vec2 a, Vec2 b) {
+    return EdgeKey(a.x, a.y, b.x, b.y);
+}
+
+// Turns the sector outlines into edges. Outlines are made counter-clockwise, then
+// every edge has to be a wall whose front faces the sector or the reverse of an
+// edge of another sector, which makes it a portal. Corners that are no polygon
+// vertex join the vertex pool.
+static int ResolveSectors(LevelSource* src) {
+    std::map<std::pair<float, float>, Uint32> vertexAt;
+    for (size_t i = 0; i < src->verts.size(); i++) vertexAt.emplace(std::make_pair(src->verts[i].x, src->verts[i].y), i);
+
+    std::map<EdgeKey, Uint32> wallByEnds, sectorByEdge;
+    for (size_t w = 0; w < src->walls.size(); w++) {
+        wallByEnds[KeyOf(src->verts[src->walls[w].v1], src->verts[src->walls[w].v2])] = w;
+    }
+
+    for (size_t s = 0; s < src->sectorOutlines.size(); s++) {
+        std::vector<Vec2>& outline = src->sectorOutlines[s];
+        if (outline.size() < 3) {
+            printf("Sector %zu needs at least 3 corners\n", s);
+            return 0;
+        }
+
+        double area = 0;
+        for (size_t i = 0; i < outline.size(); i++) {
+            Vec2 a = outline[i], b = outline[(i + 1) % outline.size()];
+            area += static_cast<double>(a.x) * b.y - static_cast<double>(b.x) * a.y;
+        }
+        if (area < 0) std::reverse(outline.begin(), outline.end());
+
+        // the game draws a concave sector through the BSP instead of the portals, so
+        // catch it here where the corner can be named. Every corner has to turn left.
+        for (size_t i = 0; i < outline.size(); i++) {
+            Vec2 a = outline[i], b = outline[(i + 1) % outline.size()], c = outline[(i + 2) % outline.size()];
+            double cross = static_cast<double>(b.x - a.x) * (c.y - b.y) - static_cast<double>(b.y - a.y) * (c.x - b.x);
+            if (cross < 0) {
+                printf("Sector %zu is not convex at (%g %g)\n", s, b.x, b.y);
+                return 0;
+            }
+        }
+
+        for (size_t i = 0; i < outline.size(); i++) {
+            if (!sectorByEdge.emplace(KeyOf(outline[i], outline[(i + 1) % outline.size()]), s).second) {
+                printf("Sector %zu overlaps another sector at (%g %g)\n", s, outline[i].x, outline[i].y);
+                return 0;
+            }
+        }
+    }
+
+    for (size_t s = 0; s < src->sectorOutlines.size(); s++) {
+        const std::vector<Vec2>& outline = src->sectorOutlines[s];
+        LevelSector sector;
+        sector.firstEdge = src->sectorEdges.size();
+        sector.edgeCount = outline.size();
+
+        for (size_t i = 0; i < outline.size(); i++) {
+            Vec2 a = outline[i], b = outline[(i + 1) % outline.size()];
+            LevelSectorEdge edge;
+            for (int end = 0; end < 2; end++) {
+                Vec2 p = end ? b : a;
+                auto found = vertexAt.emplace(std::make_pair(p.x, p.y), src->verts.size());
+                if (found.second) src->verts.push_back(p);
+                (end ? edge.v2 : edge.v1) = found.first->second;
+            }
+
+            auto wall = wallByEnds.find(KeyOf(b, a));
+            auto other = sectorByEdge.find(KeyOf(b, a));
+            if (wall != wallByEnds.end()) {
+                edge.wall = wall->second;
+                edge.sector = LEVEL_NONE;
+            } else if (other != sectorByEdge.end()) {
+                edge.wall = LEVEL_NONE;
+                edge.sector = other->second;
+            } else {
+                printf("Sector %zu: edge (%g %g) - (%g %g) is neither a wall nor shared with another sector\n", s, a.x, a.y, b.x, b.y);
+                return 0;
+            }
+            src->sectorEdges.push_back(edge);
+        }
+        src->sectors.push_back(sector);
+    }
+
+    return 1;
+}
+
+static Uint32 Align(Uint32 offset) {
+    return (offset + LEVEL_ALIGN - 1) & ~(LEVEL_ALIGN - 1);
+}
+
+static void WritePadding(FILE* out, Uint32 from, Uint32 to) {
+    static const Uint8 zeros[LEVEL_ALIGN] = { 0 };
+    if (to > from) fwrite(zeros, 1, to - from, out);
+}
+
+static int WriteLevel(const char* fileName, const LevelSource* src) {
+    LevelHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.vertexCount = src->verts.size();
+    header.wallCount = src->walls.size();
+    header.polyCount = src->polys.size();
+    header.vertexOffset = Align(sizeof(LevelHeader));
+    header.wallOffset = Align(header.vertexOffset + header.vertexCount * sizeof(Vec2));
+    header.polyOffset = Align(header.wallOffset + header.wallCount * sizeof(LevelWall));
+    header.sectorCount = src->sectors.size();
+    header.sectorEdgeCount = src->sectorEdges.size();
+    header.sectorOffset = Align(header.polyOffset + header.polyCount * sizeof(LevelPoly));
+    header.sectorEdgeOffset = Align(header.sectorOffset + header.sectorCount * sizeof(LevelSector));
+    header.fileSize = header.sectorEdgeOffset + header.sectorEdgeCount * sizeof(LevelSectorEdge);
+    header.spawnX = src->spawnX;
+    header.spawnY = src->spawnY;
+    header.spawnAngle = src->spawnAngle;
+
+    FILE* out = fopen(fileName, "wb");
+    if (!out) {
+        printf("Could not write %s\n", fileName);
+        return 0;
+    }
+
+    fwrite(&header, sizeof(header), 1, out);
+    WritePadding(out, sizeof(header), header.vertexOffset);
+    fwrite(src->verts.data(), sizeof(Vec2), src->verts.size(), out);
+    WritePadding(out, header.vertexOffset + header.vertexCount * sizeof(Vec2), header.wallOffset);
+    fwrite(src->walls.data(), sizeof(LevelWall), src->walls.size(), out);
+    WritePadding(out, header.wallOffset + header.wallCount * sizeof(LevelWall), header.polyOffset);
+    fwrite(src->polys.data(), sizeof(LevelPoly), src->polys.size(), out);
+    WritePadding(out, header.polyOffset + header.polyCount * sizeof(LevelPoly), header.sectorOffset);
+    fwrite(src->sectors.data(), sizeof(LevelSector), src->sectors.size(), out);
+    WritePadding(out, header.sectorOffset + header.sectorCount * sizeof(LevelSector), header.sectorEdgeOffset);
+    fwrite(src->sectorEdges.data(), sizeof(LevelSectorEdge), src->sectorEdges.size(), out);
+
+    int ok = ferror(out) == 0;
+    fclose(out);
+    if (ok) {
+        printf("Wrote %s: %u polygons, %u walls, %u vertices, %u sectors\n", fileName, header.polyCount, header.wallCount,
+            header.vertexCount, header.sectorCount);
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    LevelSource src;
+    src.spawnX = src.spawnY = src.spawnAngle = 0;
+
+    if (argc == 4 && strcmp(argv[1], "--generate") == 0) {
+        Generate(atoi(argv[2]), &src);
+        return WriteLevel(argv[3], &src) ? 0 : 1;
+    }
+
+    if (argc == 4 && strcmp(argv[1], "--rooms") == 0 && atoi(argv[2]) > 0) {
+        GenerateRooms(atoi(argv[2]), &src);
+        if (!ResolveSectors(&src)) return 1;
+        return WriteLevel(argv[3], &src) ? 0 : 1;
+    }
+
+    if (argc == 3) {
+        if (!ParseText(argv[1], &src) || !ResolveSectors(&src)) return 1;
+        return WriteLevel(argv[2], &src) ? 0 : 1;
+    }
+
+    printf("usage: %s <input.txt> <output.lvl>\n", argv[0]);
+    printf("       %s --generate <wallCount> <output.lvl>\n", argv[0]);
+    printf("       %s --rooms <side> <output.lvl>\n", argv[0]);
+    return 1;
+}